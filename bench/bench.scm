@@ -0,0 +1,180 @@
+;;;
+;;; Benchmark of dbd.oracle with the fake OCI library
+;;;
+;;;   gosh -I. bench.scm [rows]
+;;;
+;;; Each case reports the time and the bytes allocated per row, or per
+;;; statement for the execute and prepare loops. See fakeoci.c for the
+;;; SQL accepted by the fake library.
+;;;
+
+(use dbi)
+(use gauche.uvector)
+(use gauche.threads)
+(use dbd.oracle)
+
+(define (now-ns)
+  (receive (sec usec) (sys-gettimeofday)
+    (+ (* sec 1000000000) (* usec 1000))))
+
+;; total bytes allocated by the GC, or #f if gc-stat isn't available.
+(define (allocated-bytes)
+  (and (global-variable-bound? (find-module 'gauche) 'gc-stat)
+       (and-let* ([entry (assq :total-bytes ((with-module gauche gc-stat)))])
+         (cadr entry))))
+
+;; formats X with one decimal place.
+(define (fixed x)
+  (number->string (/ (round (* x 10)) 10.0)))
+
+;; runs THUNK, which processes N units, and prints the time and the
+;; bytes allocated per unit.
+(define (bench name n thunk)
+  (gc)
+  (let* ([bytes0 (allocated-bytes)]
+         [t0 (now-ns)])
+    (thunk)
+    (let* ([t1 (now-ns)]
+           [bytes1 (allocated-bytes)])
+      (format #t "~30a ~10d ~12a ~12a\n"
+              name n
+              (fixed (/. (- t1 t0) n))
+              (if (and bytes0 bytes1)
+                  (fixed (/. (- bytes1 bytes0) n))
+                  "-")))))
+
+(define (main args)
+  (let* ([rows (if (pair? (cdr args)) (string->number (cadr args)) 100000)]
+         [execs (quotient rows 10)]
+         [conn (dbi-connect "dbi:oracle:fake" :username "bench" :password "bench")]
+         [select (format "SELECT i1, n1, s30, d1 FROM rows_~d" rows)])
+    (format #t "~30a ~10a ~12a ~12a\n" "case" "units" "ns/unit" "bytes/unit")
+
+    (bench "fetch (iterator)" rows
+           (lambda ()
+             (for-each (lambda (row) row) (dbi-do conn select))))
+    (bench "fetch (fetch-rows!)" rows
+           (lambda ()
+             (let ([r (dbi-do conn select)]
+                   [buf (make-vector 100 #f)])
+               (let loop ()
+                 (when (= (oracle-result-fetch-rows! r buf) 100)
+                   (loop))))))
+    (bench "fetch (columns)" rows
+           (lambda ()
+             (oracle-result->columns (dbi-do conn select))))
+    (bench "fetch (4 threads, shared)" rows
+           (lambda ()
+             (for-each thread-join!
+                       (map (lambda (i)
+                              (thread-start!
+                               (make-thread
+                                (lambda ()
+                                  (for-each (lambda (row) row)
+                                            (dbi-do conn (format "SELECT i1, n1, s30, d1 FROM rows_~d"
+                                                                 (quotient rows 4))))))))
+                            (iota 4)))))
+    (bench "fetch (integer only)" rows
+           (lambda ()
+             (for-each (lambda (row) row)
+                       (dbi-do conn (format "SELECT i1 FROM rows_~d" rows)))))
+    (bench "fetch (timestamp)" rows
+           (lambda ()
+             (for-each (lambda (row) row)
+                       (dbi-do conn (format "SELECT t1 FROM rows_~d" rows)))))
+    (let ([lobs (quotient rows 100)]
+          [buf (make-u8vector 65536)])
+      (bench "fetch (clob 100KB, port)" lobs
+             (lambda ()
+               (for-each (lambda (row)
+                           (let1 in (open-oracle-lob-input-port (vector-ref row 0))
+                             (let loop ()
+                               (unless (eof-object? (read-uvector! buf in))
+                                 (loop)))))
+                         (dbi-do conn (format "SELECT c100000 FROM rows_~d" lobs)))))
+      (bench "fetch (long 100KB)" lobs
+             (lambda ()
+               (for-each (lambda (row) row)
+                         (dbi-do conn (format "SELECT l100000 FROM rows_~d" lobs)))))
+      (let ([q (dbi-prepare conn "INSERT INTO t VALUES (?)")]
+            [doc (make-string 100000 #\a)])
+        (bench "bind clob 100KB (port)" lobs
+               (lambda ()
+                 (dotimes (i lobs)
+                   (dbi-execute q (oracle-clob (open-input-string doc))))))))
+    (bench "ref (scrollable)" rows
+           (lambda ()
+             (let1 r (dbi-do conn select '(:scrollable #t))
+               (dotimes (i rows)
+                 (ref r i)))))
+
+    (let1 q (dbi-prepare conn "INSERT INTO t VALUES (?, ?, ?)")
+      (bench "bind and execute" execs
+             (lambda ()
+               (dotimes (i execs)
+                 (dbi-execute q i "name" 1.5)))))
+    (let ([q (dbi-prepare conn "INSERT INTO t VALUES (?, ?) RETURNING id INTO ?")]
+          [id (oracle-out 'integer)])
+      (bench "execute returning into" execs
+             (lambda ()
+               (dotimes (i execs)
+                 (dbi-execute q i "name" id)))))
+    (let ([q (dbi-prepare conn "UPDATE rows_0 SET name = ? WHERE id = ? RETURNING id INTO ?")]
+          [id (oracle-out 'integer)])
+      (bench "execute returning into (no rows)" execs
+             (lambda ()
+               (dotimes (i execs)
+                 (dbi-execute q "name" i id)))))
+    (let1 q (dbi-prepare conn "INSERT INTO t VALUES (?, ?, ?)")
+      (bench "execute batch (per row)" rows
+             (lambda ()
+               (let1 batch (map (lambda (i) (list i "name" 1.5)) (iota 1000))
+                 (dotimes (i (quotient rows 1000))
+                   (dbi-execute-batch q batch))))))
+    (let1 batch (map (lambda (i) (list i 1.5 "name")) (iota 1000))
+      (bench "direct path load (rows)" rows
+             (lambda ()
+               (let1 loader (make-oracle-loader conn "T" '((I integer) (N real) (S string 30)))
+                 (dotimes (i (quotient rows 1000))
+                   (oracle-loader-load! loader batch))
+                 (oracle-loader-finish! loader)))))
+    (let ([ints (list->s64vector (iota rows))]
+          [reals (make-f64vector rows 1.5)]
+          [strs (make-vector rows "name")])
+      (bench "direct path load (columns)" rows
+             (lambda ()
+               (let1 loader (make-oracle-loader conn "T" '((I integer) (N real) (S string 30)))
+                 (oracle-loader-load-columns! loader (list ints reals strs))
+                 (oracle-loader-finish! loader)))))
+    (let* ([conns (map (lambda (i)
+                         (dbi-connect "dbi:oracle:fake" :username "bench" :password "bench"))
+                       (iota 8))]
+           [qs (map (cut dbi-prepare <> "SELECT i1, s30 FROM rows_10_wait_5") conns)])
+      (bench "fan-out 8 x 5ms (blocking)" 10
+             (lambda ()
+               (dotimes (i 10)
+                 (dolist (q qs)
+                   (for-each (lambda (row) row) (dbi-execute q))))))
+      (bench "fan-out 8 x 5ms (nonblocking)" 10
+             (lambda ()
+               (dotimes (i 10)
+                 (for-each (lambda (r) (for-each (lambda (row) row) r))
+                           (oracle-async-wait (map oracle-execute-start qs))))))
+      (for-each dbi-close conns))
+    (bench "prepare (cached)" execs
+           (lambda ()
+             (dotimes (i execs)
+               (dbi-close (dbi-prepare conn "SELECT i1 FROM rows_1 WHERE i1 = ?")))))
+    (bench "prepare, execute and fetch" execs
+           (lambda ()
+             (dotimes (i execs)
+               (for-each (lambda (row) row)
+                         (dbi-do conn "SELECT i1, s30 FROM rows_1 WHERE i1 = ?" '() i)))))
+
+    (let1 stats (oracle-connection-stats conn)
+      (format #t "\nseconds in OCI calls: prepare ~a, execute ~a, fetch ~a\n"
+              (slot-ref stats 'prepare-time)
+              (slot-ref stats 'execute-time)
+              (slot-ref stats 'fetch-time)))
+    (dbi-close conn)
+    0))
@@ -0,0 +1,1450 @@
+/*
+ * bench/fakeoci.c
+ *
+ * A stand-in for libclntsh which implements the OCI calls used by
+ * dbd_oracle in memory, so that the overhead of the driver can be
+ * measured without a database.
+ *
+ * Queries read a synthetic table. The table name gives the number of
+ * rows and the first letter of each column in the select list gives
+ * its type:
+ *
+ *   SELECT i1, n1, s30, d1 FROM rows_100000
+ *
+ *   i  NUMBER(10)     the row number
+ *   n  NUMBER         the row number + 0.5
+ *   f  BINARY_DOUBLE  the row number + 0.5
+ *   sN VARCHAR2(N)    "row<row number>" padded with 'x' to N bytes
+ *   d  DATE           2009-02-14 12:34:56
+ *   t  TIMESTAMP      2009-02-14 12:34:56.789
+ *   cN CLOB           "row<row number>" padded with 'x' to N characters
+ *   lN LONG           the same as cN
+ *
+ * A table named rows_N_wait_M makes each execute and fetch of the query
+ * take M milliseconds, as if it waited for a server. A connection in
+ * nonblocking mode returns OCI_STILL_EXECUTING until they have passed
+ * since the first call instead of sleeping.
+ *
+ * Other statements read their bind values and affect as many rows as
+ * they are executed for, or no rows if they name the table rows_0. Direct path loads read the values of the
+ * column arrays and discard them. LOBs written to temporary LOBs are
+ * kept in memory until they are freed.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "oci.h"
+
+#define MAX_COLUMNS 64
+#define MAX_BINDS 64
+#define DEFAULT_DIRPATH_ROWS 100
+#define DEFAULT_DIRPATH_BUF_SIZE (64 * 1024)
+#define LOB_CHUNK_SIZE 8132
+
+struct OCIEnv {
+    int dummy;
+};
+
+struct OCIError {
+    sb4 code;
+    char msg[256];
+};
+
+struct OCIServer {
+    int nonblocking; /* OCI_ATTR_NONBLOCKING_MODE */
+};
+
+struct OCISvcCtx {
+    ub4 stmt_cache_size;
+    struct OCIServer server;
+};
+
+struct OCISPool {
+    ub4 open_count;
+    ub4 busy_count;
+    ub4 timeout;
+};
+
+struct OCIDateTime {
+    sb2 year;
+    ub1 month, day, hour, minute, second;
+    ub4 fsec;
+    sb1 tzh, tzm;
+};
+
+struct OCIParam {
+    char name[32];
+    ub2 data_type;
+    ub2 data_size;
+    sb2 precision;
+    sb1 scale;
+    ub4 lob_length; /* length of the values of a CLOB or LONG column */
+};
+
+struct OCIDefine {
+    void *valuep;
+    sb4 value_sz;
+    ub2 dty;
+    sb2 *ind;
+    ub2 *rlen;
+    OCICallbackDefine ocbfp; /* set by OCIDefineDynamic */
+    void *octxp;
+};
+
+/*
+ * A LOB locator points at the value of a CLOB column of a row or at
+ * a temporary LOB, whose value is in data.
+ */
+struct OCILobLocator {
+    ub4 rownum;
+    oraub8 length;
+    int temporary;
+    char *data;
+    oraub8 capacity;
+};
+
+struct OCIBind {
+    void *valuep;
+    sb4 value_sz;
+    ub2 dty;
+    sb2 *ind;
+    /* set by OCIBindDynamic */
+    OCICallbackInBind icbfp;
+    void *ictxp;
+    OCICallbackOutBind ocbfp;
+    void *octxp;
+    ub4 rows_returned;
+};
+
+struct OCIStmt {
+    ub2 stmt_type;
+    ub4 bind_count;
+    char bind_names[MAX_BINDS][32];
+    struct OCIBind binds[MAX_BINDS];
+    ub4 column_count;
+    struct OCIParam columns[MAX_COLUMNS];
+    struct OCIDefine defines[MAX_COLUMNS];
+    ub4 total_rows;   /* rows of the synthetic table */
+    ub4 cur_row;      /* position of the last row fetched */
+    int scrollable;   /* executed with OCI_STMT_SCROLLABLE_READONLY */
+    ub4 rows_fetched; /* rows fetched by the last call */
+    ub4 row_count;
+    int no_rows;      /* a DML statement on rows_0, which affects no rows */
+    ub4 prefetch_rows;
+    ub4 prefetch_memory;
+    OCISvcCtx *svc;   /* the connection which prepared the statement */
+    ub4 wait_ms;      /* milliseconds each execute and fetch takes */
+    double wait_until; /* when the call returning OCI_STILL_EXECUTING completes, or 0 */
+    unsigned long checksum; /* of the bind values, so that reading them isn't optimized out */
+};
+
+struct OCIDirPathCtx {
+    ub2 column_count;
+    struct OCIParam columns[MAX_COLUMNS];
+    ub4 num_rows;    /* rows of the column array */
+    ub4 buf_size;    /* bytes of the stream */
+    int prepared;
+    ub4 rows_loaded;
+};
+
+struct dirpath_entry {
+    const ub1 *valuep;
+    ub4 len;
+    ub1 flag;
+};
+
+struct OCIDirPathColArray {
+    ub2 column_count;
+    ub4 num_rows;
+    struct dirpath_entry *entries; /* num_rows * column_count */
+    ub4 row_count;   /* rows converted by the last OCIDirPathColArrayToStream */
+};
+
+struct OCIDirPathStream {
+    ub4 buf_size;
+    ub4 bytes;
+    ub4 rows;
+    unsigned long checksum; /* of the values, so that reading them isn't optimized out */
+};
+
+static sword set_error(OCIError *errhp, sb4 code, const char *msg)
+{
+    if (errhp != NULL) {
+        errhp->code = code;
+        snprintf(errhp->msg, sizeof(errhp->msg), "ORA-%05d: %s", code, msg);
+    }
+    return OCI_ERROR;
+}
+
+static int keyword_p(const char *p, const char *kw)
+{
+    size_t len = strlen(kw);
+
+    return strncasecmp(p, kw, len) == 0 && !isalnum((unsigned char)p[len]) && p[len] != '_';
+}
+
+static const char *skip_space(const char *p)
+{
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+/* counts the distinct placeholders outside string literals. */
+static void parse_binds(OCIStmt *stmt, const char *sql, const char *end)
+{
+    const char *p = sql;
+
+    while (p < end) {
+        if (*p == '\'') {
+            const char *close = memchr(p + 1, '\'', end - p - 1);
+            p = close ? close + 1 : end;
+        } else if (*p == ':' && p + 1 < end && (isalnum((unsigned char)p[1]) || p[1] == '_')) {
+            const char *start = ++p;
+            size_t len;
+            ub4 idx;
+
+            while (p < end && (isalnum((unsigned char)*p) || *p == '_')) {
+                p++;
+            }
+            len = p - start;
+            if (len >= sizeof(stmt->bind_names[0])) {
+                len = sizeof(stmt->bind_names[0]) - 1;
+            }
+            for (idx = 0; idx < stmt->bind_count; idx++) {
+                if (strncasecmp(stmt->bind_names[idx], start, len) == 0
+                    && stmt->bind_names[idx][len] == '\0') {
+                    break;
+                }
+            }
+            if (idx == stmt->bind_count && idx < MAX_BINDS) {
+                memcpy(stmt->bind_names[idx], start, len);
+                stmt->bind_names[idx][len] = '\0';
+                stmt->bind_count++;
+            }
+        } else {
+            p++;
+        }
+    }
+}
+
+/* parses "SELECT col, ... FROM rows_N". */
+/* TRUE if the statement names the table rows_0. */
+static int no_rows_p(const char *sql)
+{
+    const char *t = strstr(sql, "rows_0");
+
+    return t != NULL && !isalnum((unsigned char)t[6]) && t[6] != '_';
+}
+
+static sword parse_select(OCIStmt *stmt, OCIError *errhp, const char *p)
+{
+    char *end;
+
+    p = skip_space(p + 6);
+    while (*p != '\0' && !keyword_p(p, "FROM")) {
+        struct OCIParam *col;
+        size_t len = 0;
+
+        if (stmt->column_count == MAX_COLUMNS) {
+            return set_error(errhp, 1792, "maximum number of columns in a table or view is 1000");
+        }
+        col = &stmt->columns[stmt->column_count++];
+        while (isalnum((unsigned char)p[len]) || p[len] == '_') {
+            len++;
+        }
+        if (len == 0 || len >= sizeof(col->name)) {
+            return set_error(errhp, 936, "missing expression");
+        }
+        memcpy(col->name, p, len);
+        col->name[len] = '\0';
+        switch (tolower((unsigned char)*p)) {
+        case 'i':
+            col->data_type = SQLT_NUM;
+            col->data_size = 22;
+            col->precision = 10;
+            col->scale = 0;
+            break;
+        case 'n':
+            col->data_type = SQLT_NUM;
+            col->data_size = 22;
+            col->precision = 0;
+            col->scale = -127;
+            break;
+        case 'f':
+            col->data_type = SQLT_IBDOUBLE;
+            col->data_size = 8;
+            break;
+        case 's':
+            col->data_type = SQLT_CHR;
+            col->data_size = len > 1 ? atoi(p + 1) : 30;
+            if (col->data_size == 0) {
+                col->data_size = 30;
+            }
+            break;
+        case 'd':
+            col->data_type = SQLT_DAT;
+            col->data_size = 7;
+            break;
+        case 't':
+            col->data_type = SQLT_TIMESTAMP;
+            col->data_size = 11;
+            break;
+        case 'c':
+        case 'l':
+            col->data_type = tolower((unsigned char)*p) == 'c' ? SQLT_CLOB : SQLT_LNG;
+            col->data_size = tolower((unsigned char)*p) == 'c' ? 4000 : 0;
+            col->lob_length = len > 1 ? strtoul(p + 1, NULL, 10) : 4000;
+            break;
+        default:
+            return set_error(errhp, 904, "invalid identifier");
+        }
+        p = skip_space(p + len);
+        if (*p == ',') {
+            p = skip_space(p + 1);
+        }
+    }
+    if (*p == '\0') {
+        return set_error(errhp, 923, "FROM keyword not found where expected");
+    }
+    p = skip_space(p + 4);
+    if (strncasecmp(p, "rows_", 5) != 0) {
+        return set_error(errhp, 942, "table or view does not exist");
+    }
+    stmt->total_rows = strtoul(p + 5, &end, 10);
+    if (strncasecmp(end, "_wait_", 6) == 0) {
+        stmt->wait_ms = strtoul(end + 6, NULL, 10);
+    }
+    return OCI_SUCCESS;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Takes wait_ms milliseconds of the statement for a call. Returns TRUE
+ * if the call is still executing on a connection in nonblocking mode,
+ * where it completes when it is called after the time has passed.
+ */
+static int still_executing(OCIStmt *stmt)
+{
+    if (stmt->wait_ms == 0) {
+        return FALSE;
+    }
+    if (!stmt->svc->server.nonblocking) {
+        struct timespec ts;
+
+        ts.tv_sec = stmt->wait_ms / 1000;
+        ts.tv_nsec = (long)(stmt->wait_ms % 1000) * 1000000;
+        nanosleep(&ts, NULL);
+        return FALSE;
+    }
+    if (stmt->wait_until == 0) {
+        stmt->wait_until = now() + stmt->wait_ms / 1000.0;
+        return TRUE;
+    }
+    if (now() < stmt->wait_until) {
+        return TRUE;
+    }
+    stmt->wait_until = 0;
+    return FALSE;
+}
+
+/*
+ * stores the value of the row whose number is rownum to valuep and
+ * returns its length. data_size is the size of a string column.
+ */
+static ub4 fill_buffer(char *valuep, sb4 value_sz, ub2 dty, ub2 data_size, ub4 rownum)
+{
+    ub4 len = value_sz;
+
+    switch (dty) {
+    case SQLT_INT:
+        switch (value_sz) {
+        case 1: *(sb1*)valuep = rownum; break;
+        case 2: *(sb2*)valuep = rownum; break;
+        case 4: *(sb4*)valuep = rownum; break;
+        default: *(long long*)valuep = rownum; break;
+        }
+        break;
+    case SQLT_FLT:
+    case SQLT_BDOUBLE:
+    case SQLT_BFLOAT:
+        if (value_sz == sizeof(float)) {
+            *(float*)valuep = rownum + 0.5f;
+        } else {
+            *(double*)valuep = rownum + 0.5;
+        }
+        break;
+    case SQLT_LVC: {
+        sb4 max = value_sz - sizeof(sb4);
+        sb4 n = snprintf(valuep + sizeof(sb4), max, "row%u", rownum);
+
+        if (n >= max) {
+            n = max - 1;
+        }
+        while (n < data_size && n < max) {
+            valuep[sizeof(sb4) + n++] = 'x';
+        }
+        *(sb4*)valuep = n;
+        len = sizeof(sb4) + n;
+        break;
+    }
+    case SQLT_ODT: {
+        OCIDate *od = (OCIDate*)valuep;
+
+        od->OCIDateYYYY = 2009;
+        od->OCIDateMM = 2;
+        od->OCIDateDD = 14;
+        od->OCIDateTime.OCITimeHH = 12;
+        od->OCIDateTime.OCITimeMI = 34;
+        od->OCIDateTime.OCITimeSS = 56;
+        break;
+    }
+    case SQLT_TIMESTAMP:
+    case SQLT_TIMESTAMP_TZ:
+    case SQLT_TIMESTAMP_LTZ:
+        OCIDateTimeConstruct(NULL, NULL, *(OCIDateTime**)valuep, 2009, 2, 14, 12, 34, 56,
+                             789000000, NULL, 0);
+        break;
+    default:
+        /* others are fetched as strings in the real library. */
+        len = 0;
+        break;
+    }
+    return len;
+}
+
+/*
+ * stores len bytes from offset, which starts at zero, of the CLOB or
+ * LONG value of the row whose number is rownum to buf.
+ */
+static void fill_text(char *buf, ub4 rownum, oraub8 offset, oraub8 len)
+{
+    char prefix[16];
+    oraub8 prefix_len = snprintf(prefix, sizeof(prefix), "row%u", rownum);
+    oraub8 i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = (offset + i < prefix_len) ? prefix[offset + i] : 'x';
+    }
+}
+
+/*
+ * returns the value of a LONG column piece by piece through the
+ * callback of OCIDefineDynamic.
+ */
+static void fill_pieces(struct OCIParam *col, struct OCIDefine *def, ub4 idx, ub4 rownum)
+{
+    oraub8 done = 0;
+    ub1 piece = OCI_FIRST_PIECE;
+
+    for (;;) {
+        void *bufp;
+        ub4 *alenp;
+        void *indp;
+        ub2 *rcodep;
+        oraub8 n;
+
+        if (def->ocbfp(def->octxp, def, idx, &bufp, &alenp, &piece, &indp, &rcodep) != OCI_CONTINUE) {
+            return;
+        }
+        n = col->lob_length - done;
+        if (n > *alenp) {
+            n = *alenp;
+        }
+        fill_text(bufp, rownum, done, n);
+        *alenp = n;
+        *(sb2*)indp = 0;
+        if (rcodep != NULL) {
+            *rcodep = 0;
+        }
+        done += n;
+        if (done >= col->lob_length) {
+            return;
+        }
+        piece = OCI_NEXT_PIECE;
+    }
+}
+
+/* stores the value of a column of the row whose number is rownum. */
+static void fill_value(struct OCIParam *col, struct OCIDefine *def, ub4 idx, ub4 rownum)
+{
+    char *valuep = (char*)def->valuep + (size_t)def->value_sz * idx;
+    ub4 len;
+
+    if (def->ocbfp != NULL) {
+        fill_pieces(col, def, idx, rownum);
+        return;
+    }
+    if (def->dty == SQLT_CLOB || def->dty == SQLT_BLOB) {
+        OCILobLocator *locp = *(OCILobLocator**)valuep;
+
+        locp->rownum = rownum;
+        locp->length = col->lob_length;
+        len = def->value_sz;
+    } else {
+        len = fill_buffer(valuep, def->value_sz, def->dty, col->data_size, rownum);
+    }
+
+    def->ind[idx] = 0;
+    if (def->rlen != NULL) {
+        def->rlen[idx] = len;
+    }
+}
+
+/*
+ * returns rows rows, zero or one whose number is iter + 1, into a
+ * RETURNING INTO bind through its callbacks. As OCI does, the out-bind
+ * callback is called for the first row even if no rows are returned.
+ */
+static sword return_rows(struct OCIBind *bind, ub4 iter, ub4 rows)
+{
+    void *bufp;
+    ub4 alen;
+    ub4 *alenp;
+    ub1 piece;
+    void *indp;
+    ub2 *rcodep;
+    sb4 rv;
+
+    rv = bind->icbfp(bind->ictxp, bind, iter, 0, &bufp, &alen, &piece, &indp);
+    if (rv != OCI_CONTINUE) {
+        return OCI_ERROR;
+    }
+    bind->rows_returned = rows;
+    rv = bind->ocbfp(bind->octxp, bind, iter, 0, &bufp, &alenp, &piece, &indp, &rcodep);
+    if (rv != OCI_CONTINUE) {
+        return OCI_ERROR;
+    }
+    if (rows > 0) {
+        *alenp = fill_buffer(bufp, *alenp, bind->dty, 0, iter + 1);
+        *(sb2*)indp = 0;
+    }
+    return OCI_SUCCESS;
+}
+
+/* reads the bind values of row idx. */
+static void read_binds(OCIStmt *stmt, ub4 idx)
+{
+    ub4 pos;
+
+    for (pos = 0; pos < stmt->bind_count; pos++) {
+        struct OCIBind *bind = &stmt->binds[pos];
+        const unsigned char *p;
+        sb4 i;
+
+        if (bind->valuep == NULL || (bind->ind != NULL && bind->ind[idx] == -1)) {
+            continue;
+        }
+        p = (const unsigned char*)bind->valuep + (size_t)bind->value_sz * idx;
+        for (i = 0; i < bind->value_sz; i++) {
+            stmt->checksum += p[i];
+        }
+    }
+}
+
+sword OCIEnvCreate(OCIEnv **envp, ub4 mode, void *ctxp, void *malocfp, void *ralocfp, void *mfreefp,
+                   size_t xtramem_sz, void **usrmempp)
+{
+    *envp = calloc(1, sizeof(OCIEnv));
+    return *envp ? OCI_SUCCESS : OCI_ERROR;
+}
+
+sword OCIHandleAlloc(const void *parenth, void **hndlpp, ub4 type, size_t xtramem_sz, void **usrmempp)
+{
+    switch (type) {
+    case OCI_HTYPE_ERROR:
+        *hndlpp = calloc(1, sizeof(OCIError));
+        break;
+    case OCI_HTYPE_SVCCTX:
+        *hndlpp = calloc(1, sizeof(OCISvcCtx));
+        break;
+    case OCI_HTYPE_STMT:
+        *hndlpp = calloc(1, sizeof(OCIStmt));
+        break;
+    case OCI_HTYPE_SPOOL:
+        *hndlpp = calloc(1, sizeof(OCISPool));
+        break;
+    case OCI_HTYPE_DIRPATH_CTX: {
+        OCIDirPathCtx *ctx = calloc(1, sizeof(OCIDirPathCtx));
+
+        if (ctx != NULL) {
+            ctx->num_rows = DEFAULT_DIRPATH_ROWS;
+            ctx->buf_size = DEFAULT_DIRPATH_BUF_SIZE;
+        }
+        *hndlpp = ctx;
+        break;
+    }
+    case OCI_HTYPE_DIRPATH_COLUMN_ARRAY: {
+        const OCIDirPathCtx *ctx = parenth;
+        OCIDirPathColArray *dpca = calloc(1, sizeof(OCIDirPathColArray));
+
+        if (dpca != NULL) {
+            dpca->column_count = ctx->column_count;
+            dpca->num_rows = ctx->num_rows;
+            dpca->entries = calloc((size_t)ctx->num_rows * ctx->column_count, sizeof(struct dirpath_entry));
+        }
+        *hndlpp = dpca;
+        break;
+    }
+    case OCI_HTYPE_DIRPATH_STREAM: {
+        OCIDirPathStream *dpstr = calloc(1, sizeof(OCIDirPathStream));
+
+        if (dpstr != NULL) {
+            dpstr->buf_size = ((const OCIDirPathCtx*)parenth)->buf_size;
+        }
+        *hndlpp = dpstr;
+        break;
+    }
+    default:
+        return OCI_INVALID_HANDLE;
+    }
+    return *hndlpp ? OCI_SUCCESS : OCI_ERROR;
+}
+
+sword OCIHandleFree(void *hndlp, ub4 type)
+{
+    if (type == OCI_HTYPE_DIRPATH_COLUMN_ARRAY) {
+        free(((OCIDirPathColArray*)hndlp)->entries);
+    }
+    free(hndlp);
+    return OCI_SUCCESS;
+}
+
+sword OCIDescriptorAlloc(const void *parenth, void **descpp, ub4 type, size_t xtramem_sz, void **usrmempp)
+{
+    switch (type) {
+    case OCI_DTYPE_LOB:
+        *descpp = calloc(1, sizeof(OCILobLocator));
+        return *descpp ? OCI_SUCCESS : OCI_ERROR;
+    case OCI_DTYPE_TIMESTAMP:
+    case OCI_DTYPE_TIMESTAMP_TZ:
+    case OCI_DTYPE_TIMESTAMP_LTZ:
+        *descpp = calloc(1, sizeof(OCIDateTime));
+        return *descpp ? OCI_SUCCESS : OCI_ERROR;
+    }
+    return OCI_INVALID_HANDLE;
+}
+
+sword OCIDescriptorFree(void *descp, ub4 type)
+{
+    if (type == OCI_DTYPE_PARAM) {
+        /* parameters are parts of their handles. */
+        return OCI_SUCCESS;
+    }
+    if (type == OCI_DTYPE_LOB && descp != NULL) {
+        free(((OCILobLocator*)descp)->data);
+    }
+    free(descp);
+    return OCI_SUCCESS;
+}
+
+#define SET_ATTR(type, val) do { \
+    *(type*)attributep = (val); \
+    if (sizep != NULL) { \
+        *sizep = sizeof(type); \
+    } \
+} while (0)
+
+sword OCIAttrGet(const void *trgthndlp, ub4 trghndltyp, void *attributep, ub4 *sizep, ub4 attrtype,
+                 OCIError *errhp)
+{
+    switch (trghndltyp) {
+    case OCI_HTYPE_STMT: {
+        const OCIStmt *stmt = trgthndlp;
+
+        switch (attrtype) {
+        case OCI_ATTR_STMT_TYPE: SET_ATTR(ub2, stmt->stmt_type); return OCI_SUCCESS;
+        case OCI_ATTR_PARAM_COUNT: SET_ATTR(ub4, stmt->column_count); return OCI_SUCCESS;
+        case OCI_ATTR_ROWS_FETCHED: SET_ATTR(ub4, stmt->rows_fetched); return OCI_SUCCESS;
+        case OCI_ATTR_CURRENT_POSITION: SET_ATTR(ub4, stmt->cur_row); return OCI_SUCCESS;
+        case OCI_ATTR_ROW_COUNT: SET_ATTR(ub4, stmt->row_count); return OCI_SUCCESS;
+        case OCI_ATTR_NUM_DML_ERRORS: SET_ATTR(ub4, 0); return OCI_SUCCESS;
+        case OCI_ATTR_PREFETCH_ROWS: SET_ATTR(ub4, stmt->prefetch_rows); return OCI_SUCCESS;
+        case OCI_ATTR_PREFETCH_MEMORY: SET_ATTR(ub4, stmt->prefetch_memory); return OCI_SUCCESS;
+        }
+        break;
+    }
+    case OCI_HTYPE_BIND: {
+        const struct OCIBind *bind = trgthndlp;
+
+        switch (attrtype) {
+        case OCI_ATTR_ROWS_RETURNED: SET_ATTR(ub4, bind->rows_returned); return OCI_SUCCESS;
+        }
+        break;
+    }
+    case OCI_DTYPE_PARAM: {
+        const struct OCIParam *col = trgthndlp;
+
+        switch (attrtype) {
+        case OCI_ATTR_NAME:
+            *(const char**)attributep = col->name;
+            if (sizep != NULL) {
+                *sizep = strlen(col->name);
+            }
+            return OCI_SUCCESS;
+        case OCI_ATTR_DATA_TYPE: SET_ATTR(ub2, col->data_type); return OCI_SUCCESS;
+        case OCI_ATTR_DATA_SIZE: SET_ATTR(ub2, col->data_size); return OCI_SUCCESS;
+        case OCI_ATTR_CHAR_SIZE:
+            SET_ATTR(ub2, col->data_type == SQLT_CHR ? col->data_size : 0);
+            return OCI_SUCCESS;
+        case OCI_ATTR_CHAR_USED: SET_ATTR(ub1, 0); return OCI_SUCCESS;
+        case OCI_ATTR_PRECISION: SET_ATTR(sb2, col->precision); return OCI_SUCCESS;
+        case OCI_ATTR_SCALE: SET_ATTR(sb1, col->scale); return OCI_SUCCESS;
+        }
+        break;
+    }
+    case OCI_HTYPE_SVCCTX:
+        switch (attrtype) {
+        case OCI_ATTR_STMTCACHESIZE:
+            SET_ATTR(ub4, ((const OCISvcCtx*)trgthndlp)->stmt_cache_size);
+            return OCI_SUCCESS;
+        case OCI_ATTR_SERVER:
+            *(const OCIServer**)attributep = &((const OCISvcCtx*)trgthndlp)->server;
+            return OCI_SUCCESS;
+        }
+        break;
+    case OCI_HTYPE_SERVER:
+        if (attrtype == OCI_ATTR_NONBLOCKING_MODE) {
+            SET_ATTR(ub1, ((const OCIServer*)trgthndlp)->nonblocking);
+            return OCI_SUCCESS;
+        }
+        break;
+    case OCI_HTYPE_DIRPATH_CTX:
+        if (attrtype == OCI_ATTR_LIST_COLUMNS) {
+            /* the column list is the context itself. See OCIParamGet. */
+            *(const void**)attributep = trgthndlp;
+            return OCI_SUCCESS;
+        }
+        break;
+    case OCI_HTYPE_DIRPATH_COLUMN_ARRAY: {
+        const OCIDirPathColArray *dpca = trgthndlp;
+
+        switch (attrtype) {
+        case OCI_ATTR_NUM_ROWS: SET_ATTR(ub4, dpca->num_rows); return OCI_SUCCESS;
+        case OCI_ATTR_ROW_COUNT: SET_ATTR(ub4, dpca->row_count); return OCI_SUCCESS;
+        }
+        break;
+    }
+    case OCI_HTYPE_SPOOL: {
+        const OCISPool *pool = trgthndlp;
+
+        switch (attrtype) {
+        case OCI_ATTR_SPOOL_OPEN_COUNT: SET_ATTR(ub4, pool->open_count); return OCI_SUCCESS;
+        case OCI_ATTR_SPOOL_BUSY_COUNT: SET_ATTR(ub4, pool->busy_count); return OCI_SUCCESS;
+        case OCI_ATTR_SPOOL_TIMEOUT: SET_ATTR(ub4, pool->timeout); return OCI_SUCCESS;
+        }
+        break;
+    }
+    }
+    return set_error(errhp, 24315, "illegal attribute type");
+}
+
+/* sets an attribute of a direct path context or of one of its columns. */
+static sword set_dirpath_attr(void *trgthndlp, ub4 trghndltyp, void *attributep, ub4 size, ub4 attrtype,
+                              OCIError *errhp)
+{
+    if (trghndltyp == OCI_DTYPE_PARAM) {
+        struct OCIParam *col = trgthndlp;
+
+        switch (attrtype) {
+        case OCI_ATTR_NAME:
+            snprintf(col->name, sizeof(col->name), "%.*s", (int)size, (const char*)attributep);
+            return OCI_SUCCESS;
+        case OCI_ATTR_DATA_TYPE: col->data_type = *(ub2*)attributep; return OCI_SUCCESS;
+        case OCI_ATTR_DATA_SIZE: col->data_size = *(ub4*)attributep; return OCI_SUCCESS;
+        case OCI_ATTR_DATEFORMAT: return OCI_SUCCESS;
+        }
+    } else {
+        OCIDirPathCtx *ctx = trgthndlp;
+
+        switch (attrtype) {
+        case OCI_ATTR_NAME:
+        case OCI_ATTR_SCHEMA_NAME:
+            return OCI_SUCCESS;
+        case OCI_ATTR_NUM_COLS:
+            if (*(ub2*)attributep > MAX_COLUMNS) {
+                return set_error(errhp, 1792, "maximum number of columns in a table or view is 64");
+            }
+            ctx->column_count = *(ub2*)attributep;
+            return OCI_SUCCESS;
+        case OCI_ATTR_NUM_ROWS: ctx->num_rows = *(ub4*)attributep; return OCI_SUCCESS;
+        case OCI_ATTR_BUF_SIZE: ctx->buf_size = *(ub4*)attributep; return OCI_SUCCESS;
+        }
+    }
+    return set_error(errhp, 24315, "illegal attribute type");
+}
+
+sword OCIAttrSet(void *trgthndlp, ub4 trghndltyp, void *attributep, ub4 size, ub4 attrtype,
+                 OCIError *errhp)
+{
+    ub4 val;
+
+    if (trghndltyp == OCI_HTYPE_DIRPATH_CTX || trghndltyp == OCI_DTYPE_PARAM) {
+        return set_dirpath_attr(trgthndlp, trghndltyp, attributep, size, attrtype, errhp);
+    }
+    if (trghndltyp == OCI_HTYPE_SERVER && attrtype == OCI_ATTR_NONBLOCKING_MODE) {
+        /* toggles the mode. */
+        ((OCIServer*)trgthndlp)->nonblocking = !((OCIServer*)trgthndlp)->nonblocking;
+        return OCI_SUCCESS;
+    }
+    val = *(ub4*)attributep;
+    switch (trghndltyp) {
+    case OCI_HTYPE_STMT:
+        switch (attrtype) {
+        case OCI_ATTR_PREFETCH_ROWS: ((OCIStmt*)trgthndlp)->prefetch_rows = val; return OCI_SUCCESS;
+        case OCI_ATTR_PREFETCH_MEMORY: ((OCIStmt*)trgthndlp)->prefetch_memory = val; return OCI_SUCCESS;
+        }
+        break;
+    case OCI_HTYPE_SVCCTX:
+        if (attrtype == OCI_ATTR_STMTCACHESIZE) {
+            ((OCISvcCtx*)trgthndlp)->stmt_cache_size = val;
+            return OCI_SUCCESS;
+        }
+        break;
+    case OCI_HTYPE_SPOOL:
+        if (attrtype == OCI_ATTR_SPOOL_TIMEOUT) {
+            ((OCISPool*)trgthndlp)->timeout = val;
+            return OCI_SUCCESS;
+        }
+        break;
+    }
+    return set_error(errhp, 24315, "illegal attribute type");
+}
+
+sword OCIParamGet(const void *hndlp, ub4 htype, OCIError *errhp, void **parmdpp, ub4 pos)
+{
+    const OCIStmt *stmt = hndlp;
+
+    if (htype == OCI_DTYPE_PARAM) {
+        /* a column of the column list of a direct path context */
+        const OCIDirPathCtx *ctx = hndlp;
+
+        if (pos < 1 || pos > ctx->column_count) {
+            return set_error(errhp, 24334, "no descriptor for this position");
+        }
+        *parmdpp = (void*)&ctx->columns[pos - 1];
+        return OCI_SUCCESS;
+    }
+
+    if (htype != OCI_HTYPE_STMT || pos < 1 || pos > stmt->column_count) {
+        return set_error(errhp, 24334, "no descriptor for this position");
+    }
+    *parmdpp = (void*)&stmt->columns[pos - 1];
+    return OCI_SUCCESS;
+}
+
+sword OCIErrorGet(void *hndlp, ub4 recordno, OraText *sqlstate, sb4 *errcodep, OraText *bufp,
+                  ub4 bufsiz, ub4 type)
+{
+    const char *msg = "ORA-24300: bad value for mode";
+    sb4 code = 24300;
+
+    if (type == OCI_HTYPE_ERROR) {
+        code = ((OCIError*)hndlp)->code;
+        msg = ((OCIError*)hndlp)->msg;
+    }
+    if (recordno != 1 || code == 0) {
+        return OCI_NO_DATA;
+    }
+    *errcodep = code;
+    snprintf((char*)bufp, bufsiz, "%s", msg);
+    return OCI_SUCCESS;
+}
+
+sword OCINlsNumericInfoGet(void *envhp, OCIError *errhp, sb4 *val, ub2 item)
+{
+    if (item != OCI_NLS_CHARSET_MAXBYTESZ) {
+        return set_error(errhp, 1804, "failure to initialize timezone information");
+    }
+    /* as AL32UTF8 */
+    *val = 4;
+    return OCI_SUCCESS;
+}
+
+sword OCILogon2(OCIEnv *envhp, OCIError *errhp, OCISvcCtx **svchp, const OraText *username, ub4 uname_len,
+                const OraText *password, ub4 passwd_len, const OraText *dbname, ub4 dbname_len, ub4 mode)
+{
+    return OCIHandleAlloc(envhp, (void**)svchp, OCI_HTYPE_SVCCTX, 0, NULL);
+}
+
+sword OCILogoff(OCISvcCtx *svchp, OCIError *errhp)
+{
+    /* svchp is freed by OCIHandleFree. */
+    return OCI_SUCCESS;
+}
+
+sword OCITransCommit(OCISvcCtx *svchp, OCIError *errhp, ub4 flags)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCITransRollback(OCISvcCtx *svchp, OCIError *errhp, ub4 flags)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCISessionPoolCreate(OCIEnv *envhp, OCIError *errhp, OCISPool *spoolhp, OraText **poolName,
+                           ub4 *poolNameLen, const OraText *connStr, ub4 connStrLen, ub4 sessMin,
+                           ub4 sessMax, ub4 sessIncr, OraText *userid, ub4 useridLen,
+                           OraText *password, ub4 passwordLen, ub4 mode)
+{
+    *poolName = (OraText*)"fakepool";
+    *poolNameLen = 8;
+    spoolhp->open_count = sessMin;
+    return OCI_SUCCESS;
+}
+
+sword OCISessionPoolDestroy(OCISPool *spoolhp, OCIError *errhp, ub4 mode)
+{
+    return OCI_SUCCESS;
+}
+
+sword OCISessionGet(OCIEnv *envhp, OCIError *errhp, OCISvcCtx **svchp, OCIAuthInfo *authhp,
+                    OraText *poolName, ub4 poolName_len, const OraText *tagInfo, ub4 tagInfo_len,
+                    OraText **retTagInfo, ub4 *retTagInfo_len, boolean *found, ub4 mode)
+{
+    /* the pool isn't looked up by its name, so its counts don't change. */
+    return OCIHandleAlloc(envhp, (void**)svchp, OCI_HTYPE_SVCCTX, 0, NULL);
+}
+
+sword OCISessionRelease(OCISvcCtx *svchp, OCIError *errhp, OraText *tag, ub4 tag_len, ub4 mode)
+{
+    free(svchp);
+    return OCI_SUCCESS;
+}
+
+sword OCIStmtPrepare2(OCISvcCtx *svchp, OCIStmt **stmtp, OCIError *errhp, const OraText *stmt,
+                      ub4 stmt_len, const OraText *key, ub4 key_len, ub4 language, ub4 mode)
+{
+    const char *sql = (const char*)stmt;
+    const char *p = skip_space(sql);
+    OCIStmt *s = calloc(1, sizeof(OCIStmt));
+
+    if (s == NULL) {
+        return set_error(errhp, 4030, "out of process memory");
+    }
+    *stmtp = s;
+    s->svc = svchp;
+    parse_binds(s, sql, sql + stmt_len);
+    if (keyword_p(p, "SELECT")) {
+        s->stmt_type = OCI_STMT_SELECT;
+        return parse_select(s, errhp, p);
+    } else if (keyword_p(p, "INSERT")) {
+        s->stmt_type = OCI_STMT_INSERT;
+    } else if (keyword_p(p, "UPDATE")) {
+        s->stmt_type = OCI_STMT_UPDATE;
+    } else if (keyword_p(p, "DELETE")) {
+        s->stmt_type = OCI_STMT_DELETE;
+    } else if (keyword_p(p, "BEGIN")) {
+        s->stmt_type = OCI_STMT_BEGIN;
+    } else if (keyword_p(p, "DECLARE")) {
+        s->stmt_type = OCI_STMT_DECLARE;
+    } else {
+        return set_error(errhp, 900, "invalid SQL statement");
+    }
+    s->no_rows = no_rows_p(p);
+    return OCI_SUCCESS;
+}
+
+sword OCIStmtRelease(OCIStmt *stmtp, OCIError *errhp, const OraText *key, ub4 key_len, ub4 mode)
+{
+    free(stmtp);
+    return OCI_SUCCESS;
+}
+
+sword OCIStmtGetBindInfo(OCIStmt *stmtp, OCIError *errhp, ub4 size, ub4 startloc, sb4 *found,
+                         OraText *bvnp[], ub1 bvnl[], OraText *invp[], ub1 inpl[], ub1 dupl[],
+                         OCIBind *hndl[])
+{
+    ub4 idx;
+
+    if (stmtp->bind_count == 0) {
+        return OCI_NO_DATA;
+    }
+    *found = stmtp->bind_count > size ? - (sb4)stmtp->bind_count : (sb4)stmtp->bind_count;
+    for (idx = 0; idx < size && startloc - 1 + idx < stmtp->bind_count; idx++) {
+        char *name = stmtp->bind_names[startloc - 1 + idx];
+
+        bvnp[idx] = (OraText*)name;
+        bvnl[idx] = strlen(name);
+        invp[idx] = NULL;
+        inpl[idx] = 0;
+        dupl[idx] = 0;
+        hndl[idx] = NULL;
+    }
+    return OCI_SUCCESS;
+}
+
+static sword bind(OCIStmt *stmtp, OCIBind **bindp, OCIError *errhp, ub4 idx, void *valuep,
+                  sb4 value_sz, ub2 dty, void *indp)
+{
+    struct OCIBind *bind = &stmtp->binds[idx];
+
+    bind->valuep = valuep;
+    bind->value_sz = value_sz;
+    bind->dty = dty;
+    bind->ind = indp;
+    bind->icbfp = NULL;
+    bind->ocbfp = NULL;
+    *bindp = bind;
+    return OCI_SUCCESS;
+}
+
+sword OCIBindDynamic(OCIBind *bindp, OCIError *errhp, void *ictxp, OCICallbackInBind icbfp, void *octxp,
+                     OCICallbackOutBind ocbfp)
+{
+    bindp->icbfp = icbfp;
+    bindp->ictxp = ictxp;
+    bindp->ocbfp = ocbfp;
+    bindp->octxp = octxp;
+    return OCI_SUCCESS;
+}
+
+sword OCIBindByPos(OCIStmt *stmtp, OCIBind **bindp, OCIError *errhp, ub4 position, void *valuep,
+                   sb4 value_sz, ub2 dty, void *indp, ub2 *alenp, ub2 *rcodep, ub4 maxarr_len,
+                   ub4 *curelep, ub4 mode)
+{
+    if (position < 1 || position > stmtp->bind_count) {
+        return set_error(errhp, 1036, "illegal variable name/number");
+    }
+    return bind(stmtp, bindp, errhp, position - 1, valuep, value_sz, dty, indp);
+}
+
+sword OCIBindByName(OCIStmt *stmtp, OCIBind **bindp, OCIError *errhp, const OraText *placeholder,
+                    sb4 placeh_len, void *valuep, sb4 value_sz, ub2 dty, void *indp, ub2 *alenp,
+                    ub2 *rcodep, ub4 maxarr_len, ub4 *curelep, ub4 mode)
+{
+    const char *name = (const char*)placeholder;
+    ub4 idx;
+
+    if (placeh_len > 0 && name[0] == ':') {
+        name++;
+        placeh_len--;
+    }
+    for (idx = 0; idx < stmtp->bind_count; idx++) {
+        if (strncasecmp(stmtp->bind_names[idx], name, placeh_len) == 0
+            && stmtp->bind_names[idx][placeh_len] == '\0') {
+            return bind(stmtp, bindp, errhp, idx, valuep, value_sz, dty, indp);
+        }
+    }
+    return set_error(errhp, 1036, "illegal variable name/number");
+}
+
+sword OCIDefineByPos(OCIStmt *stmtp, OCIDefine **defnp, OCIError *errhp, ub4 position, void *valuep,
+                     sb4 value_sz, ub2 dty, void *indp, ub2 *rlenp, ub2 *rcodep, ub4 mode)
+{
+    struct OCIDefine *def;
+
+    if (position < 1 || position > stmtp->column_count) {
+        return set_error(errhp, 1007, "variable not in select list");
+    }
+    def = &stmtp->defines[position - 1];
+    def->valuep = valuep;
+    def->value_sz = value_sz;
+    def->dty = dty;
+    def->ind = indp;
+    def->rlen = rlenp;
+    def->ocbfp = NULL;
+    def->octxp = NULL;
+    *defnp = def;
+    return OCI_SUCCESS;
+}
+
+sword OCIDefineDynamic(OCIDefine *defnp, OCIError *errhp, void *octxp, OCICallbackDefine ocbfp)
+{
+    defnp->ocbfp = ocbfp;
+    defnp->octxp = octxp;
+    return OCI_SUCCESS;
+}
+
+sword OCIStmtExecute(OCISvcCtx *svchp, OCIStmt *stmtp, OCIError *errhp, ub4 iters, ub4 rowoff,
+                     const OCISnapshot *snap_in, OCISnapshot *snap_out, ub4 mode)
+{
+    ub4 idx;
+
+    if (still_executing(stmtp)) {
+        return OCI_STILL_EXECUTING;
+    }
+    if (stmtp->stmt_type == OCI_STMT_SELECT) {
+        stmtp->cur_row = 0;
+        stmtp->rows_fetched = 0;
+        stmtp->row_count = 0;
+        stmtp->scrollable = (mode & OCI_STMT_SCROLLABLE_READONLY) != 0;
+        return OCI_SUCCESS;
+    }
+    if (iters == 0) {
+        return set_error(errhp, 24333, "zero iteration count");
+    }
+    for (idx = 0; idx < iters; idx++) {
+        ub4 pos;
+
+        read_binds(stmtp, rowoff + idx);
+        for (pos = 0; pos < stmtp->bind_count; pos++) {
+            struct OCIBind *bind = &stmtp->binds[pos];
+
+            if (bind->ocbfp != NULL && return_rows(bind, idx, stmtp->no_rows ? 0 : 1) != OCI_SUCCESS) {
+                return set_error(errhp, 24343, "user defined callback error");
+            }
+        }
+    }
+    stmtp->row_count = stmtp->no_rows ? 0 : iters;
+    return OCI_SUCCESS;
+}
+
+sword OCIStmtFetch2(OCIStmt *stmtp, OCIError *errhp, ub4 nrows, ub2 orientation, sb4 fetchOffset, ub4 mode)
+{
+    long start; /* index of the first row to be fetched */
+    ub4 rows;
+    ub4 pos;
+    ub4 idx;
+
+    if (stmtp->stmt_type != OCI_STMT_SELECT) {
+        return set_error(errhp, 24374, "define not done before fetch or execute and fetch");
+    }
+    if (nrows == 0) {
+        /* cancels the cursor */
+        stmtp->cur_row = stmtp->total_rows;
+        stmtp->rows_fetched = 0;
+        return OCI_SUCCESS;
+    }
+    if (orientation != OCI_FETCH_NEXT && !stmtp->scrollable) {
+        return set_error(errhp, 24391, "invalid fetch operation");
+    }
+    if (still_executing(stmtp)) {
+        return OCI_STILL_EXECUTING;
+    }
+    switch (orientation) {
+    case OCI_FETCH_NEXT: start = stmtp->cur_row; break;
+    case OCI_FETCH_CURRENT: start = (long)stmtp->cur_row - 1; break;
+    case OCI_FETCH_PRIOR: start = (long)stmtp->cur_row - 2; break;
+    case OCI_FETCH_FIRST: start = 0; break;
+    case OCI_FETCH_LAST: start = (long)stmtp->total_rows - 1; nrows = 1; break;
+    case OCI_FETCH_ABSOLUTE: start = (long)fetchOffset - 1; break;
+    case OCI_FETCH_RELATIVE: start = (long)stmtp->cur_row - 1 + fetchOffset; break;
+    default: return set_error(errhp, 24391, "invalid fetch operation");
+    }
+    if (start < 0 || start >= (long)stmtp->total_rows) {
+        stmtp->rows_fetched = 0;
+        return OCI_NO_DATA;
+    }
+    stmtp->cur_row = start;
+    rows = stmtp->total_rows - stmtp->cur_row;
+    if (rows > nrows) {
+        rows = nrows;
+    }
+    for (pos = 0; pos < stmtp->column_count; pos++) {
+        struct OCIDefine *def = &stmtp->defines[pos];
+
+        if (def->valuep == NULL && def->ocbfp == NULL) {
+            return set_error(errhp, 24374, "define not done before fetch or execute and fetch");
+        }
+        for (idx = 0; idx < rows; idx++) {
+            fill_value(&stmtp->columns[pos], def, idx, stmtp->cur_row + idx + 1);
+        }
+    }
+    stmtp->cur_row += rows;
+    stmtp->rows_fetched = rows;
+    stmtp->row_count = stmtp->cur_row;
+    return rows < nrows ? OCI_NO_DATA : OCI_SUCCESS;
+}
+
+sword OCIDirPathPrepare(OCIDirPathCtx *dpctx, OCISvcCtx *svchp, OCIError *errhp)
+{
+    ub2 col;
+
+    for (col = 0; col < dpctx->column_count; col++) {
+        if (dpctx->columns[col].name[0] == '\0') {
+            return set_error(errhp, 26003, "column not found in table");
+        }
+    }
+    dpctx->prepared = 1;
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathColArrayEntrySet(OCIDirPathColArray *dpca, OCIError *errhp, ub4 rownum, ub2 colIdx,
+                                 ub1 *cvalp, ub4 clen, ub1 cflg)
+{
+    struct dirpath_entry *entry;
+
+    if (rownum >= dpca->num_rows || colIdx >= dpca->column_count) {
+        return set_error(errhp, 26002, "column array index out of range");
+    }
+    entry = &dpca->entries[(size_t)rownum * dpca->column_count + colIdx];
+    entry->valuep = cvalp;
+    entry->len = clen;
+    entry->flag = cflg;
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathColArrayToStream(OCIDirPathColArray *dpca, const OCIDirPathCtx *dpctx,
+                                 OCIDirPathStream *dpstr, OCIError *errhp, ub4 rowcnt, ub4 rowoff)
+{
+    ub4 row;
+
+    for (row = rowoff; row < rowcnt; row++) {
+        const struct dirpath_entry *entry = &dpca->entries[(size_t)row * dpca->column_count];
+        ub4 bytes = 0;
+        ub2 col;
+
+        for (col = 0; col < dpca->column_count; col++) {
+            bytes += 4 + entry[col].len;
+        }
+        if (dpstr->rows > 0 && dpstr->bytes + bytes > dpstr->buf_size) {
+            dpca->row_count = row - rowoff;
+            return OCI_CONTINUE;
+        }
+        for (col = 0; col < dpca->column_count; col++) {
+            const struct OCIParam *param = &dpctx->columns[col];
+            ub4 i;
+
+            if (entry[col].flag == OCI_DIRPATH_COL_NULL) {
+                continue;
+            }
+            if (entry[col].len > param->data_size) {
+                dpca->row_count = row - rowoff;
+                return set_error(errhp, 12899, "value too large for column");
+            }
+            for (i = 0; i < entry[col].len; i++) {
+                dpstr->checksum += entry[col].valuep[i];
+            }
+        }
+        dpstr->bytes += bytes;
+        dpstr->rows++;
+    }
+    dpca->row_count = rowcnt - rowoff;
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathColArrayReset(OCIDirPathColArray *dpca, OCIError *errhp)
+{
+    dpca->row_count = 0;
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathLoadStream(OCIDirPathCtx *dpctx, OCIDirPathStream *dpstr, OCIError *errhp)
+{
+    if (!dpctx->prepared) {
+        return set_error(errhp, 26028, "direct path context is not prepared");
+    }
+    dpctx->rows_loaded += dpstr->rows;
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathStreamReset(OCIDirPathStream *dpstr, OCIError *errhp)
+{
+    dpstr->bytes = 0;
+    dpstr->rows = 0;
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathFinish(OCIDirPathCtx *dpctx, OCIError *errhp)
+{
+    if (!dpctx->prepared) {
+        return set_error(errhp, 26028, "direct path context is not prepared");
+    }
+    dpctx->prepared = 0;
+    return OCI_SUCCESS;
+}
+
+sword OCIDirPathAbort(OCIDirPathCtx *dpctx, OCIError *errhp)
+{
+    dpctx->prepared = 0;
+    dpctx->rows_loaded = 0;
+    return OCI_SUCCESS;
+}
+
+sword OCIDateTimeConstruct(void *hndl, OCIError *err, OCIDateTime *datetime, sb2 yr, ub1 mnth, ub1 dy,
+                           ub1 hr, ub1 mm, ub1 ss, ub4 fsec, OraText *timezone, size_t timezone_length)
+{
+    datetime->year = yr;
+    datetime->month = mnth;
+    datetime->day = dy;
+    datetime->hour = hr;
+    datetime->minute = mm;
+    datetime->second = ss;
+    datetime->fsec = fsec;
+    datetime->tzh = 0;
+    datetime->tzm = 0;
+    if (timezone != NULL && timezone_length >= 6) {
+        /* [+-]HH:MM */
+        int sign = timezone[0] == '-' ? -1 : 1;
+
+        datetime->tzh = sign * atoi((const char*)timezone + 1);
+        datetime->tzm = sign * atoi((const char*)timezone + 4);
+    }
+    return OCI_SUCCESS;
+}
+
+sword OCIDateTimeGetDate(void *hndl, OCIError *err, const OCIDateTime *datetime, sb2 *yr, ub1 *mnth,
+                         ub1 *dy)
+{
+    *yr = datetime->year;
+    *mnth = datetime->month;
+    *dy = datetime->day;
+    return OCI_SUCCESS;
+}
+
+sword OCIDateTimeGetTime(void *hndl, OCIError *err, OCIDateTime *datetime, ub1 *hr, ub1 *mm, ub1 *ss,
+                         ub4 *fsec)
+{
+    *hr = datetime->hour;
+    *mm = datetime->minute;
+    *ss = datetime->second;
+    *fsec = datetime->fsec;
+    return OCI_SUCCESS;
+}
+
+sword OCIDateTimeGetTimeZoneOffset(void *hndl, OCIError *err, const OCIDateTime *datetime, sb1 *hr,
+                                   sb1 *mm)
+{
+    *hr = datetime->tzh;
+    *mm = datetime->tzm;
+    return OCI_SUCCESS;
+}
+
+sword OCILobLocatorAssign(OCISvcCtx *svchp, OCIError *errhp, const OCILobLocator *src_locp,
+                          OCILobLocator **dst_locpp)
+{
+    OCILobLocator *dst = *dst_locpp;
+
+    if (dst == NULL) {
+        return set_error(errhp, 22275, "invalid LOB locator specified");
+    }
+    free(dst->data);
+    *dst = *src_locp;
+    if (src_locp->temporary) {
+        /* a temporary LOB is copied to a new temporary LOB. */
+        dst->data = malloc(src_locp->capacity ? src_locp->capacity : 1);
+        if (dst->data == NULL) {
+            return set_error(errhp, 4030, "out of process memory");
+        }
+        memcpy(dst->data, src_locp->data, src_locp->length);
+    }
+    return OCI_SUCCESS;
+}
+
+sword OCILobCharSetForm(OCIEnv *envhp, OCIError *errhp, const OCILobLocator *locp, ub1 *csfrm)
+{
+    *csfrm = SQLCS_IMPLICIT;
+    return OCI_SUCCESS;
+}
+
+sword OCILobIsTemporary(OCIEnv *envhp, OCIError *errhp, OCILobLocator *locp, boolean *is_temporary)
+{
+    *is_temporary = locp->temporary;
+    return OCI_SUCCESS;
+}
+
+sword OCILobCreateTemporary(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, ub2 csid, ub1 csfrm,
+                            ub1 lobtype, boolean cache, ub2 duration)
+{
+    free(locp->data);
+    memset(locp, 0, sizeof(*locp));
+    locp->temporary = 1;
+    return OCI_SUCCESS;
+}
+
+sword OCILobFreeTemporary(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp)
+{
+    if (!locp->temporary) {
+        return set_error(errhp, 22275, "invalid LOB locator specified");
+    }
+    free(locp->data);
+    memset(locp, 0, sizeof(*locp));
+    return OCI_SUCCESS;
+}
+
+sword OCILobGetLength2(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, oraub8 *lenp)
+{
+    *lenp = locp->length;
+    return OCI_SUCCESS;
+}
+
+sword OCILobGetChunkSize(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, ub4 *chunksizep)
+{
+    *chunksizep = LOB_CHUNK_SIZE;
+    return OCI_SUCCESS;
+}
+
+/* reads in one piece. Characters are single bytes. */
+sword OCILobRead2(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, oraub8 *byte_amtp,
+                  oraub8 *char_amtp, oraub8 offset, void *bufp, oraub8 bufl, ub1 piece, void *ctxp,
+                  OCICallbackLobRead2 cbfp, ub2 csid, ub1 csfrm)
+{
+    oraub8 amt = *char_amtp ? *char_amtp : *byte_amtp;
+
+    if (piece != OCI_ONE_PIECE) {
+        return set_error(errhp, 24801, "illegal parameter value in OCI lob function");
+    }
+    if (offset == 0) {
+        return set_error(errhp, 22003, "offset must be 1 or greater");
+    }
+    if (offset > locp->length) {
+        *byte_amtp = 0;
+        *char_amtp = 0;
+        return OCI_NO_DATA;
+    }
+    if (amt == 0 || amt > bufl) {
+        amt = bufl;
+    }
+    if (amt > locp->length - (offset - 1)) {
+        amt = locp->length - (offset - 1);
+    }
+    if (locp->temporary) {
+        memcpy(bufp, locp->data + offset - 1, amt);
+    } else {
+        fill_text(bufp, locp->rownum, offset - 1, amt);
+    }
+    *byte_amtp = amt;
+    *char_amtp = amt;
+    return OCI_SUCCESS;
+}
+
+/* writes to a temporary LOB in polling mode. */
+sword OCILobWrite2(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, oraub8 *byte_amtp,
+                   oraub8 *char_amtp, oraub8 offset, void *bufp, oraub8 buflen, ub1 piece, void *ctxp,
+                   OCICallbackLobWrite2 cbfp, ub2 csid, ub1 csfrm)
+{
+    oraub8 end;
+
+    if (!locp->temporary) {
+        return set_error(errhp, 22990, "LOB locators cannot span transactions");
+    }
+    if (piece == OCI_ONE_PIECE || piece == OCI_FIRST_PIECE) {
+        if (offset == 0 || offset > locp->length + 1) {
+            return set_error(errhp, 22003, "offset must be 1 or greater");
+        }
+        locp->length = offset - 1;
+    }
+    end = locp->length + buflen;
+    if (end > locp->capacity) {
+        oraub8 cap = locp->capacity ? locp->capacity : LOB_CHUNK_SIZE;
+        char *data;
+
+        while (cap < end) {
+            cap *= 2;
+        }
+        data = realloc(locp->data, cap);
+        if (data == NULL) {
+            return set_error(errhp, 4030, "out of process memory");
+        }
+        locp->data = data;
+        locp->capacity = cap;
+    }
+    memcpy(locp->data + locp->length, bufp, buflen);
+    locp->length = end;
+    *byte_amtp = buflen;
+    return (piece == OCI_FIRST_PIECE || piece == OCI_NEXT_PIECE) ? OCI_NEED_DATA : OCI_SUCCESS;
+}
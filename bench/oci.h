@@ -0,0 +1,295 @@
+/*
+ * bench/oci.h
+ *
+ * The part of oci.h used by dbd_oracle, for building the extension
+ * against the fake OCI library in fakeoci.c. The values are the same
+ * as the ones of Oracle's oci.h.
+ */
+
+#ifndef BENCH_OCI_H
+#define BENCH_OCI_H
+
+#include <stddef.h>
+
+typedef unsigned char ub1;
+typedef signed char sb1;
+typedef unsigned short ub2;
+typedef signed short sb2;
+typedef unsigned int ub4;
+typedef signed int sb4;
+typedef unsigned long long oraub8;
+typedef int sword;
+typedef void dvoid;
+typedef unsigned char OraText;
+typedef unsigned char text;
+typedef int boolean;
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+typedef struct OCIEnv OCIEnv;
+typedef struct OCIError OCIError;
+typedef struct OCISvcCtx OCISvcCtx;
+typedef struct OCIServer OCIServer;
+typedef struct OCIStmt OCIStmt;
+typedef struct OCIBind OCIBind;
+typedef struct OCIDefine OCIDefine;
+typedef struct OCIParam OCIParam;
+typedef struct OCISnapshot OCISnapshot;
+typedef struct OCISPool OCISPool;
+typedef struct OCIAuthInfo OCIAuthInfo;
+typedef struct OCIDateTime OCIDateTime;
+typedef struct OCIDirPathCtx OCIDirPathCtx;
+typedef struct OCIDirPathColArray OCIDirPathColArray;
+typedef struct OCIDirPathStream OCIDirPathStream;
+typedef struct OCILobLocator OCILobLocator;
+
+typedef struct OCITime {
+    ub1 OCITimeHH;
+    ub1 OCITimeMI;
+    ub1 OCITimeSS;
+} OCITime;
+
+typedef struct OCIDate {
+    sb2 OCIDateYYYY;
+    ub1 OCIDateMM;
+    ub1 OCIDateDD;
+    OCITime OCIDateTime;
+} OCIDate;
+
+typedef sb4 (*OCICallbackInBind)(void *ictxp, OCIBind *bindp, ub4 iter, ub4 index, void **bufpp,
+                                 ub4 *alenp, ub1 *piecep, void **indp);
+typedef sb4 (*OCICallbackOutBind)(void *octxp, OCIBind *bindp, ub4 iter, ub4 index, void **bufpp,
+                                  ub4 **alenp, ub1 *piecep, void **indp, ub2 **rcodep);
+typedef sb4 (*OCICallbackDefine)(void *octxp, OCIDefine *defnp, ub4 iter, void **bufpp, ub4 **alenp,
+                                 ub1 *piecep, void **indp, ub2 **rcodep);
+typedef sb4 (*OCICallbackLobRead2)(void *ctxp, const void *bufp, oraub8 lenp, ub1 piecep,
+                                   void **changed_bufpp, oraub8 *changed_lenp);
+typedef sb4 (*OCICallbackLobWrite2)(void *ctxp, void *bufp, oraub8 *lenp, ub1 *piece,
+                                    void **changed_bufpp, oraub8 *changed_lenp);
+
+#define SB4MAXVAL 0x7FFFFFFF
+
+/* return codes */
+#define OCI_SUCCESS 0
+#define OCI_SUCCESS_WITH_INFO 1
+#define OCI_NEED_DATA 99
+#define OCI_NO_DATA 100
+#define OCI_ERROR -1
+#define OCI_INVALID_HANDLE -2
+#define OCI_STILL_EXECUTING -3123
+#define OCI_CONTINUE -24200
+
+/* modes */
+#define OCI_DEFAULT 0x00
+#define OCI_THREADED 0x01
+#define OCI_OBJECT 0x02
+#define OCI_NTV_SYNTAX 1
+#define OCI_FETCH_CURRENT 0x01
+#define OCI_FETCH_NEXT 0x02
+#define OCI_FETCH_FIRST 0x04
+#define OCI_FETCH_LAST 0x08
+#define OCI_FETCH_PRIOR 0x10
+#define OCI_FETCH_ABSOLUTE 0x20
+#define OCI_FETCH_RELATIVE 0x40
+#define OCI_STMT_SCROLLABLE_READONLY 0x08
+#define OCI_DATA_AT_EXEC 0x02
+#define OCI_COMMIT_ON_SUCCESS 0x20
+#define OCI_BATCH_ERRORS 0x80
+#define OCI_STRLS_CACHE_DELETE 0x0010
+#define OCI_LOGON2_STMTCACHE 4
+#define OCI_SPC_HOMOGENEOUS 0x0002
+#define OCI_SPC_STMTCACHE 0x0004
+#define OCI_SPD_FORCE 0x0001
+#define OCI_SESSGET_SPOOL 0x0001
+#define OCI_DYNAMIC_FETCH 0x02
+#define OCI_ONE_PIECE 0
+#define OCI_FIRST_PIECE 1
+#define OCI_NEXT_PIECE 2
+#define OCI_LAST_PIECE 3
+#define OCI_TEMP_BLOB 1
+#define OCI_TEMP_CLOB 2
+#define OCI_DURATION_SESSION 10
+
+/* handle and descriptor types */
+#define OCI_HTYPE_ENV 1
+#define OCI_HTYPE_ERROR 2
+#define OCI_HTYPE_SVCCTX 3
+#define OCI_HTYPE_STMT 4
+#define OCI_HTYPE_BIND 5
+#define OCI_HTYPE_DEFINE 6
+#define OCI_HTYPE_SERVER 8
+#define OCI_HTYPE_DIRPATH_CTX 14
+#define OCI_HTYPE_DIRPATH_COLUMN_ARRAY 15
+#define OCI_HTYPE_DIRPATH_STREAM 16
+#define OCI_HTYPE_SPOOL 27
+#define OCI_DTYPE_LOB 50
+#define OCI_DTYPE_PARAM 53
+#define OCI_DTYPE_TIMESTAMP 68
+#define OCI_DTYPE_TIMESTAMP_TZ 69
+#define OCI_DTYPE_TIMESTAMP_LTZ 70
+
+/* attributes */
+#define OCI_ATTR_DATA_SIZE 1
+#define OCI_ATTR_DATA_TYPE 2
+#define OCI_ATTR_NONBLOCKING_MODE 3
+#define OCI_ATTR_NAME 4
+#define OCI_ATTR_PRECISION 5
+#define OCI_ATTR_SCALE 6
+#define OCI_ATTR_SERVER 6
+#define OCI_ATTR_ROW_COUNT 9
+#define OCI_ATTR_SCHEMA_NAME 9
+#define OCI_ATTR_PREFETCH_ROWS 11
+#define OCI_ATTR_PREFETCH_MEMORY 13
+#define OCI_ATTR_PARAM_COUNT 18
+#define OCI_ATTR_ROWS_RETURNED 42
+#define OCI_ATTR_STMT_TYPE 24
+#define OCI_ATTR_NUM_DML_ERRORS 73
+#define OCI_ATTR_DML_ROW_OFFSET 74
+#define OCI_ATTR_DATEFORMAT 75
+#define OCI_ATTR_BUF_SIZE 77
+#define OCI_ATTR_NUM_ROWS 81
+#define OCI_ATTR_NUM_COLS 102
+#define OCI_ATTR_LIST_COLUMNS 103
+#define OCI_ATTR_CURRENT_POSITION 164
+#define OCI_ATTR_STMTCACHESIZE 176
+#define OCI_ATTR_ROWS_FETCHED 197
+#define OCI_ATTR_CHAR_USED 285
+#define OCI_ATTR_CHAR_SIZE 286
+#define OCI_ATTR_SPOOL_TIMEOUT 308
+#define OCI_ATTR_SPOOL_BUSY_COUNT 310
+#define OCI_ATTR_SPOOL_OPEN_COUNT 311
+
+/* statement types */
+#define OCI_STMT_SELECT 1
+#define OCI_STMT_UPDATE 2
+#define OCI_STMT_DELETE 3
+#define OCI_STMT_INSERT 4
+#define OCI_STMT_BEGIN 8
+#define OCI_STMT_DECLARE 9
+#define OCI_STMT_MERGE 16
+
+#define OCI_NLS_CHARSET_MAXBYTESZ 91
+
+/* character set forms */
+#define SQLCS_IMPLICIT 1
+#define SQLCS_NCHAR 2
+
+/* direct path column flags */
+#define OCI_DIRPATH_COL_COMPLETE 0
+#define OCI_DIRPATH_COL_NULL 1
+
+/* data types */
+#define SQLT_CHR 1
+#define SQLT_NUM 2
+#define SQLT_INT 3
+#define SQLT_FLT 4
+#define SQLT_LNG 8
+#define SQLT_DAT 12
+#define SQLT_BFLOAT 21
+#define SQLT_BDOUBLE 22
+#define SQLT_BIN 23
+#define SQLT_LBI 24
+#define SQLT_LVC 94
+#define SQLT_AFC 96
+#define SQLT_IBFLOAT 100
+#define SQLT_IBDOUBLE 101
+#define SQLT_CLOB 112
+#define SQLT_BLOB 113
+#define SQLT_ODT 156
+#define SQLT_TIMESTAMP 187
+#define SQLT_TIMESTAMP_TZ 188
+#define SQLT_TIMESTAMP_LTZ 232
+
+sword OCIEnvCreate(OCIEnv **envp, ub4 mode, void *ctxp, void *malocfp, void *ralocfp, void *mfreefp,
+                   size_t xtramem_sz, void **usrmempp);
+sword OCIHandleAlloc(const void *parenth, void **hndlpp, ub4 type, size_t xtramem_sz, void **usrmempp);
+sword OCIHandleFree(void *hndlp, ub4 type);
+sword OCIDescriptorAlloc(const void *parenth, void **descpp, ub4 type, size_t xtramem_sz, void **usrmempp);
+sword OCIDescriptorFree(void *descp, ub4 type);
+sword OCIAttrGet(const void *trgthndlp, ub4 trghndltyp, void *attributep, ub4 *sizep, ub4 attrtype,
+                 OCIError *errhp);
+sword OCIAttrSet(void *trgthndlp, ub4 trghndltyp, void *attributep, ub4 size, ub4 attrtype,
+                 OCIError *errhp);
+sword OCIParamGet(const void *hndlp, ub4 htype, OCIError *errhp, void **parmdpp, ub4 pos);
+sword OCIErrorGet(void *hndlp, ub4 recordno, OraText *sqlstate, sb4 *errcodep, OraText *bufp,
+                  ub4 bufsiz, ub4 type);
+sword OCINlsNumericInfoGet(void *envhp, OCIError *errhp, sb4 *val, ub2 item);
+
+sword OCILogon2(OCIEnv *envhp, OCIError *errhp, OCISvcCtx **svchp, const OraText *username, ub4 uname_len,
+                const OraText *password, ub4 passwd_len, const OraText *dbname, ub4 dbname_len, ub4 mode);
+sword OCILogoff(OCISvcCtx *svchp, OCIError *errhp);
+sword OCITransCommit(OCISvcCtx *svchp, OCIError *errhp, ub4 flags);
+sword OCITransRollback(OCISvcCtx *svchp, OCIError *errhp, ub4 flags);
+
+sword OCISessionPoolCreate(OCIEnv *envhp, OCIError *errhp, OCISPool *spoolhp, OraText **poolName,
+                           ub4 *poolNameLen, const OraText *connStr, ub4 connStrLen, ub4 sessMin,
+                           ub4 sessMax, ub4 sessIncr, OraText *userid, ub4 useridLen,
+                           OraText *password, ub4 passwordLen, ub4 mode);
+sword OCISessionPoolDestroy(OCISPool *spoolhp, OCIError *errhp, ub4 mode);
+sword OCISessionGet(OCIEnv *envhp, OCIError *errhp, OCISvcCtx **svchp, OCIAuthInfo *authhp,
+                    OraText *poolName, ub4 poolName_len, const OraText *tagInfo, ub4 tagInfo_len,
+                    OraText **retTagInfo, ub4 *retTagInfo_len, boolean *found, ub4 mode);
+sword OCISessionRelease(OCISvcCtx *svchp, OCIError *errhp, OraText *tag, ub4 tag_len, ub4 mode);
+
+sword OCIStmtPrepare2(OCISvcCtx *svchp, OCIStmt **stmtp, OCIError *errhp, const OraText *stmt,
+                      ub4 stmt_len, const OraText *key, ub4 key_len, ub4 language, ub4 mode);
+sword OCIStmtRelease(OCIStmt *stmtp, OCIError *errhp, const OraText *key, ub4 key_len, ub4 mode);
+sword OCIStmtGetBindInfo(OCIStmt *stmtp, OCIError *errhp, ub4 size, ub4 startloc, sb4 *found,
+                         OraText *bvnp[], ub1 bvnl[], OraText *invp[], ub1 inpl[], ub1 dupl[],
+                         OCIBind *hndl[]);
+sword OCIBindByPos(OCIStmt *stmtp, OCIBind **bindp, OCIError *errhp, ub4 position, void *valuep,
+                   sb4 value_sz, ub2 dty, void *indp, ub2 *alenp, ub2 *rcodep, ub4 maxarr_len,
+                   ub4 *curelep, ub4 mode);
+sword OCIBindByName(OCIStmt *stmtp, OCIBind **bindp, OCIError *errhp, const OraText *placeholder,
+                    sb4 placeh_len, void *valuep, sb4 value_sz, ub2 dty, void *indp, ub2 *alenp,
+                    ub2 *rcodep, ub4 maxarr_len, ub4 *curelep, ub4 mode);
+sword OCIBindDynamic(OCIBind *bindp, OCIError *errhp, void *ictxp, OCICallbackInBind icbfp, void *octxp,
+                     OCICallbackOutBind ocbfp);
+sword OCIDefineByPos(OCIStmt *stmtp, OCIDefine **defnp, OCIError *errhp, ub4 position, void *valuep,
+                     sb4 value_sz, ub2 dty, void *indp, ub2 *rlenp, ub2 *rcodep, ub4 mode);
+sword OCIDefineDynamic(OCIDefine *defnp, OCIError *errhp, void *octxp, OCICallbackDefine ocbfp);
+sword OCIStmtExecute(OCISvcCtx *svchp, OCIStmt *stmtp, OCIError *errhp, ub4 iters, ub4 rowoff,
+                     const OCISnapshot *snap_in, OCISnapshot *snap_out, ub4 mode);
+sword OCIStmtFetch2(OCIStmt *stmtp, OCIError *errhp, ub4 nrows, ub2 orientation, sb4 fetchOffset,
+                    ub4 mode);
+
+sword OCIDirPathPrepare(OCIDirPathCtx *dpctx, OCISvcCtx *svchp, OCIError *errhp);
+sword OCIDirPathColArrayEntrySet(OCIDirPathColArray *dpca, OCIError *errhp, ub4 rownum, ub2 colIdx,
+                                 ub1 *cvalp, ub4 clen, ub1 cflg);
+sword OCIDirPathColArrayToStream(OCIDirPathColArray *dpca, const OCIDirPathCtx *dpctx,
+                                 OCIDirPathStream *dpstr, OCIError *errhp, ub4 rowcnt, ub4 rowoff);
+sword OCIDirPathColArrayReset(OCIDirPathColArray *dpca, OCIError *errhp);
+sword OCIDirPathLoadStream(OCIDirPathCtx *dpctx, OCIDirPathStream *dpstr, OCIError *errhp);
+sword OCIDirPathStreamReset(OCIDirPathStream *dpstr, OCIError *errhp);
+sword OCIDirPathFinish(OCIDirPathCtx *dpctx, OCIError *errhp);
+sword OCIDirPathAbort(OCIDirPathCtx *dpctx, OCIError *errhp);
+
+sword OCIDateTimeConstruct(void *hndl, OCIError *err, OCIDateTime *datetime, sb2 yr, ub1 mnth, ub1 dy,
+                           ub1 hr, ub1 mm, ub1 ss, ub4 fsec, OraText *timezone, size_t timezone_length);
+sword OCIDateTimeGetDate(void *hndl, OCIError *err, const OCIDateTime *datetime, sb2 *yr, ub1 *mnth,
+                         ub1 *dy);
+sword OCIDateTimeGetTime(void *hndl, OCIError *err, OCIDateTime *datetime, ub1 *hr, ub1 *mm, ub1 *ss,
+                         ub4 *fsec);
+sword OCIDateTimeGetTimeZoneOffset(void *hndl, OCIError *err, const OCIDateTime *datetime, sb1 *hr,
+                                   sb1 *mm);
+
+sword OCILobLocatorAssign(OCISvcCtx *svchp, OCIError *errhp, const OCILobLocator *src_locp,
+                          OCILobLocator **dst_locpp);
+sword OCILobCharSetForm(OCIEnv *envhp, OCIError *errhp, const OCILobLocator *locp, ub1 *csfrm);
+sword OCILobIsTemporary(OCIEnv *envhp, OCIError *errhp, OCILobLocator *locp, boolean *is_temporary);
+sword OCILobCreateTemporary(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, ub2 csid, ub1 csfrm,
+                            ub1 lobtype, boolean cache, ub2 duration);
+sword OCILobFreeTemporary(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp);
+sword OCILobGetLength2(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, oraub8 *lenp);
+sword OCILobGetChunkSize(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, ub4 *chunksizep);
+sword OCILobRead2(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, oraub8 *byte_amtp,
+                  oraub8 *char_amtp, oraub8 offset, void *bufp, oraub8 bufl, ub1 piece, void *ctxp,
+                  OCICallbackLobRead2 cbfp, ub2 csid, ub1 csfrm);
+sword OCILobWrite2(OCISvcCtx *svchp, OCIError *errhp, OCILobLocator *locp, oraub8 *byte_amtp,
+                   oraub8 *char_amtp, oraub8 offset, void *bufp, oraub8 buflen, ub1 piece, void *ctxp,
+                   OCICallbackLobWrite2 cbfp, ub2 csid, ub1 csfrm);
+
+#endif /* BENCH_OCI_H */
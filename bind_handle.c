@@ -1,3 +1,4 @@
+#include <time.h>
 #include "dbd_oracle.h"
 
 
@@ -12,35 +13,32 @@ typedef struct {
 
 static void str_init(bind_handle_t *hndl, u_int size)
 {
-    lvc_string_t *lvc;
     sb4 value_sz = sizeof(sb4) + size;
 
+    /* keep the length prefix of each array element aligned. */
+    value_sz = (value_sz + sizeof(sb4) - 1) & ~(sizeof(sb4) - 1);
     hndl->value_sz = value_sz;
-    hndl->valuep = malloc(value_sz);
-    hndl->ind = -1;
-    lvc = hndl->valuep;
-    lvc->size = 0;
 }
 
 static void str_clear(bind_handle_t *hndl)
 {
-    free(hndl->valuep);
+    /* do noting */
 }
 
-static void str_set(bind_handle_t *hndl, ScmObj val)
+static void str_set(bind_handle_t *hndl, ub4 idx, ScmObj val)
 {
     if (SCM_NULLP(val)) {
-        hndl->ind = -1;
+        hndl->ind[idx] = -1;
     } else if (SCM_STRINGP(val)) {
         unsigned int length;
         const char *str = Scm_GetStringContent(SCM_STRING(val), NULL, &length, NULL);
-	lvc_string_t *lvc = hndl->valuep;
+	lvc_string_t *lvc = (lvc_string_t *)BIND_HANDLE_VALUE(hndl, idx);
 	sb4 max_size = hndl->value_sz - sizeof(sb4);
 
 	if (length > max_size) {
 	  Scm_Error("too large string to bind: %d for %d", length, max_size);
 	}
-        hndl->ind = 0;
+        hndl->ind[idx] = 0;
 	lvc->size = length;
 	memcpy(lvc->buf, str, length);
     } else {
@@ -48,12 +46,12 @@ static void str_set(bind_handle_t *hndl, ScmObj val)
     }
 }
 
-static ScmObj str_get(bind_handle_t *hndl)
+static ScmObj str_get(bind_handle_t *hndl, ub4 idx)
 {
-    if (hndl->ind) {
+    if (hndl->ind[idx]) {
         return SCM_NIL;
     } else {
-	lvc_string_t *lvc = hndl->valuep;
+	lvc_string_t *lvc = (lvc_string_t *)BIND_HANDLE_VALUE(hndl, idx);
 	return Scm_MakeString(lvc->buf, lvc->size, -1, SCM_STRING_COPYING);
     }
 }
@@ -65,8 +63,6 @@ static ScmObj str_get(bind_handle_t *hndl)
 static void int_init(bind_handle_t *hndl, u_int size)
 {
     hndl->value_sz = sizeof(long);
-    hndl->valuep = &hndl->value.l;
-    hndl->ind = -1;
 }
 
 static void int_clear(bind_handle_t *hndl)
@@ -74,24 +70,24 @@ static void int_clear(bind_handle_t *hndl)
     /* do noting */
 }
 
-static void int_set(bind_handle_t *hndl, ScmObj val)
+static void int_set(bind_handle_t *hndl, ub4 idx, ScmObj val)
 {
     if (SCM_NULLP(val)) {
-        hndl->ind = -1;
+        hndl->ind[idx] = -1;
     } else if (SCM_INTEGERP(val)) {
-        hndl->value.l = Scm_GetInteger(val);
-        hndl->ind = 0;
+        ((long*)hndl->valuep)[idx] = Scm_GetInteger(val);
+        hndl->ind[idx] = 0;
     } else {
         Scm_Error("neither integer nor null");
     }
 }
 
-static ScmObj int_get(bind_handle_t *hndl)
+static ScmObj int_get(bind_handle_t *hndl, ub4 idx)
 {
-    if (hndl->ind) {
+    if (hndl->ind[idx]) {
         return SCM_NIL;
     } else {
-        return Scm_MakeInteger(hndl->value.l);
+        return Scm_MakeInteger(((long*)hndl->valuep)[idx]);
     }
 }
 
@@ -103,8 +99,6 @@ static ScmObj int_get(bind_handle_t *hndl)
 static void flt_init(bind_handle_t *hndl, u_int size)
 {
     hndl->value_sz = sizeof(double);
-    hndl->valuep = &hndl->value.d;
-    hndl->ind = -1;
 }
 
 static void flt_clear(bind_handle_t *hndl)
@@ -112,28 +106,547 @@ static void flt_clear(bind_handle_t *hndl)
     /* do noting */
 }
 
-static void flt_set(bind_handle_t *hndl, ScmObj val)
+static void flt_set(bind_handle_t *hndl, ub4 idx, ScmObj val)
+{
+    if (SCM_NULLP(val)) {
+        hndl->ind[idx] = -1;
+    } else if (SCM_REALP(val)) {
+        ((double*)hndl->valuep)[idx] = Scm_GetDouble(val);
+        hndl->ind[idx] = 0;
+    } else {
+        Scm_Error("neither real nor null");
+    }
+}
+
+static ScmObj flt_get(bind_handle_t *hndl, ub4 idx)
+{
+    if (hndl->ind[idx]) {
+        return SCM_NIL;
+    } else {
+        return Scm_MakeFlonum(((double*)hndl->valuep)[idx]);
+    }
+}
+
+
+/*
+ * BIND_BFLOAT and BIND_BDOUBLE
+ */
+
+static void bflt_init(bind_handle_t *hndl, u_int size)
+{
+    hndl->value_sz = sizeof(float);
+}
+
+static void bflt_set(bind_handle_t *hndl, ub4 idx, ScmObj val)
 {
     if (SCM_NULLP(val)) {
-        hndl->ind = -1;
+        hndl->ind[idx] = -1;
     } else if (SCM_REALP(val)) {
-        hndl->value.d = Scm_GetDouble(val);
-        hndl->ind = 0;
+        ((float*)hndl->valuep)[idx] = (float)Scm_GetDouble(val);
+        hndl->ind[idx] = 0;
     } else {
         Scm_Error("neither real nor null");
     }
 }
 
-static ScmObj flt_get(bind_handle_t *hndl)
+static ScmObj bflt_get(bind_handle_t *hndl, ub4 idx)
+{
+    if (hndl->ind[idx]) {
+        return SCM_NIL;
+    } else {
+        return Scm_MakeFlonum(((float*)hndl->valuep)[idx]);
+    }
+}
+
+static void bflt_clear(bind_handle_t *hndl)
+{
+    /* do noting */
+}
+
+/* BINARY_DOUBLE is a C double, the same as BIND_REAL. */
+
+
+/*
+ * Conversion between <date>/<time> and Oracle's date and time.
+ */
+
+static ScmObj date_proc(ScmObj *var, const char *name)
+{
+    SCM_BIND_PROC(*var, name, SCM_MODULE(SCM_FIND_MODULE("srfi-19", 0)));
+    return *var;
+}
+
+static ScmObj proc_make_date = SCM_UNDEFINED;
+static ScmObj proc_date_p = SCM_UNDEFINED;
+static ScmObj proc_date_nanosecond = SCM_UNDEFINED;
+static ScmObj proc_date_second = SCM_UNDEFINED;
+static ScmObj proc_date_minute = SCM_UNDEFINED;
+static ScmObj proc_date_hour = SCM_UNDEFINED;
+static ScmObj proc_date_day = SCM_UNDEFINED;
+static ScmObj proc_date_month = SCM_UNDEFINED;
+static ScmObj proc_date_year = SCM_UNDEFINED;
+static ScmObj proc_date_zone_offset = SCM_UNDEFINED;
+
+typedef struct {
+    int year, month, day, hour, minute, second;
+    long nanosecond;
+    long zone_offset; /* seconds east of UTC */
+} date_fields_t;
+
+/* days since 1970-01-01 in the proleptic Gregorian calendar */
+static long days_from_civil(int y, int m, int d)
+{
+    long era;
+    long yoe, doy, doe;
+
+    y -= m <= 2;
+    era = (y >= 0 ? y : y - 399) / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static long local_seconds(const date_fields_t *f)
+{
+    return days_from_civil(f->year, f->month, f->day) * 86400L
+        + f->hour * 3600L + f->minute * 60L + f->second;
+}
+
+/* offset of the local time zone at the local time in f */
+static long local_zone_offset(const date_fields_t *f)
+{
+    struct tm tm;
+    time_t t;
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = f->year - 1900;
+    tm.tm_mon = f->month - 1;
+    tm.tm_mday = f->day;
+    tm.tm_hour = f->hour;
+    tm.tm_min = f->minute;
+    tm.tm_sec = f->second;
+    tm.tm_isdst = -1;
+    t = mktime(&tm);
+    if (t == (time_t)-1) {
+        return 0;
+    }
+    return local_seconds(f) - (long)t;
+}
+
+static ScmObj make_date(const date_fields_t *f)
+{
+    return Scm_ApplyRec(date_proc(&proc_make_date, "make-date"),
+                        Scm_List(Scm_MakeInteger(f->nanosecond),
+                                 SCM_MAKE_INT(f->second), SCM_MAKE_INT(f->minute),
+                                 SCM_MAKE_INT(f->hour), SCM_MAKE_INT(f->day),
+                                 SCM_MAKE_INT(f->month), SCM_MAKE_INT(f->year),
+                                 Scm_MakeInteger(f->zone_offset), NULL));
+}
+
+static int date_field(ScmObj *var, const char *name, ScmObj date)
+{
+    return Scm_GetInteger(Scm_ApplyRec(date_proc(var, name), SCM_LIST1(date)));
+}
+
+/*
+ * Gets the fields of a <date> or a <time>. A <time> is converted to
+ * the date in UTC.
+ */
+static void get_date_fields(ScmObj val, date_fields_t *f)
+{
+    if (SCM_TIMEP(val)) {
+        ScmTime *t = SCM_TIME(val);
+        long days = (long)(t->sec / 86400);
+        long secs = (long)(t->sec % 86400);
+        long era, doe, yoe, doy, mp;
+
+        if (secs < 0) {
+            secs += 86400;
+            days--;
+        }
+        /* civil_from_days */
+        days += 719468;
+        era = (days >= 0 ? days : days - 146096) / 146097;
+        doe = days - era * 146097;
+        yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        mp = (5 * doy + 2) / 153;
+        f->day = doy - (153 * mp + 2) / 5 + 1;
+        f->month = mp < 10 ? mp + 3 : mp - 9;
+        f->year = yoe + era * 400 + (f->month <= 2);
+        f->hour = secs / 3600;
+        f->minute = secs / 60 % 60;
+        f->second = secs % 60;
+        f->nanosecond = t->nsec;
+        f->zone_offset = 0;
+    } else if (!SCM_FALSEP(Scm_ApplyRec(date_proc(&proc_date_p, "date?"), SCM_LIST1(val)))) {
+        f->year = date_field(&proc_date_year, "date-year", val);
+        f->month = date_field(&proc_date_month, "date-month", val);
+        f->day = date_field(&proc_date_day, "date-day", val);
+        f->hour = date_field(&proc_date_hour, "date-hour", val);
+        f->minute = date_field(&proc_date_minute, "date-minute", val);
+        f->second = date_field(&proc_date_second, "date-second", val);
+        f->nanosecond = date_field(&proc_date_nanosecond, "date-nanosecond", val);
+        f->zone_offset = date_field(&proc_date_zone_offset, "date-zone-offset", val);
+    } else {
+        Scm_Error("neither <date>, <time> nor null");
+    }
+}
+
+static void chkerr(bind_handle_t *hndl, sword rv)
+{
+    if (rv != OCI_SUCCESS) {
+        Scm_oracle_raise_error(rv, hndl->errhp, OCI_HTYPE_ERROR);
+    }
+}
+
+
+/*
+ * BIND_DATE
+ */
+
+static void dat_init(bind_handle_t *hndl, u_int size)
+{
+    hndl->value_sz = sizeof(OCIDate);
+}
+
+static void dat_clear(bind_handle_t *hndl)
+{
+    /* do noting */
+}
+
+static void dat_set(bind_handle_t *hndl, ub4 idx, ScmObj val)
+{
+    if (SCM_NULLP(val)) {
+        hndl->ind[idx] = -1;
+    } else {
+        OCIDate *od = &((OCIDate*)hndl->valuep)[idx];
+        date_fields_t f;
+
+        get_date_fields(val, &f);
+        od->OCIDateYYYY = f.year;
+        od->OCIDateMM = f.month;
+        od->OCIDateDD = f.day;
+        od->OCIDateTime.OCITimeHH = f.hour;
+        od->OCIDateTime.OCITimeMI = f.minute;
+        od->OCIDateTime.OCITimeSS = f.second;
+        hndl->ind[idx] = 0;
+    }
+}
+
+static ScmObj dat_get(bind_handle_t *hndl, ub4 idx)
 {
-    if (hndl->ind) {
+    if (hndl->ind[idx]) {
         return SCM_NIL;
     } else {
-        return Scm_MakeFlonum(hndl->value.d);
+        OCIDate *od = &((OCIDate*)hndl->valuep)[idx];
+        date_fields_t f;
+
+        f.year = od->OCIDateYYYY;
+        f.month = od->OCIDateMM;
+        f.day = od->OCIDateDD;
+        f.hour = od->OCIDateTime.OCITimeHH;
+        f.minute = od->OCIDateTime.OCITimeMI;
+        f.second = od->OCIDateTime.OCITimeSS;
+        f.nanosecond = 0;
+        f.zone_offset = local_zone_offset(&f);
+        return make_date(&f);
     }
 }
 
 
+/*
+ * BIND_TIMESTAMP, BIND_TIMESTAMP_TZ and BIND_TIMESTAMP_LTZ
+ *
+ * valuep is an array of OCIDateTime descriptors.
+ */
+
+static ub4 ts_dtype(bind_handle_t *hndl)
+{
+    switch (hndl->vptr->dty) {
+    case SQLT_TIMESTAMP_TZ:
+        return OCI_DTYPE_TIMESTAMP_TZ;
+    case SQLT_TIMESTAMP_LTZ:
+        return OCI_DTYPE_TIMESTAMP_LTZ;
+    default:
+        return OCI_DTYPE_TIMESTAMP;
+    }
+}
+
+static void ts_init(bind_handle_t *hndl, u_int size)
+{
+    hndl->value_sz = sizeof(OCIDateTime*);
+}
+
+static int ts_setup(bind_handle_t *hndl)
+{
+    OCIDateTime **dts = hndl->valuep;
+    ub4 idx;
+
+    for (idx = 0; idx < hndl->max_rows; idx++) {
+        if (OCIDescriptorAlloc(envhp, (dvoid**)&dts[idx], ts_dtype(hndl), 0, NULL) != OCI_SUCCESS) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void ts_clear(bind_handle_t *hndl)
+{
+    OCIDateTime **dts = hndl->valuep;
+    ub4 idx;
+
+    if (dts == NULL) {
+        return;
+    }
+    for (idx = 0; idx < hndl->max_rows; idx++) {
+        if (dts[idx] != NULL) {
+            OCIDescriptorFree(dts[idx], ts_dtype(hndl));
+            dts[idx] = NULL;
+        }
+    }
+}
+
+static void ts_set(bind_handle_t *hndl, ub4 idx, ScmObj val)
+{
+    if (SCM_NULLP(val)) {
+        hndl->ind[idx] = -1;
+    } else {
+        OCIDateTime *dt = ((OCIDateTime**)hndl->valuep)[idx];
+        date_fields_t f;
+        char tz[16];
+        OraText *tzp = NULL;
+        size_t tzlen = 0;
+
+        get_date_fields(val, &f);
+        if (hndl->vptr->dty != SQLT_TIMESTAMP) {
+            long off = f.zone_offset;
+            char sign = off < 0 ? '-' : '+';
+
+            if (off < 0) {
+                off = -off;
+            }
+            snprintf(tz, sizeof(tz), "%c%02ld:%02ld", sign, off / 3600, off / 60 % 60);
+            tzp = (OraText*)tz;
+            tzlen = strlen(tz);
+        }
+        chkerr(hndl, OCIDateTimeConstruct(envhp, hndl->errhp, dt, f.year, f.month, f.day,
+                                          f.hour, f.minute, f.second, f.nanosecond, tzp, tzlen));
+        hndl->ind[idx] = 0;
+    }
+}
+
+static ScmObj ts_get(bind_handle_t *hndl, ub4 idx)
+{
+    if (hndl->ind[idx]) {
+        return SCM_NIL;
+    } else {
+        OCIDateTime *dt = ((OCIDateTime**)hndl->valuep)[idx];
+        sb2 year;
+        ub1 month, day, hour, minute, second;
+        ub4 fsec;
+        date_fields_t f;
+
+        chkerr(hndl, OCIDateTimeGetDate(envhp, hndl->errhp, dt, &year, &month, &day));
+        chkerr(hndl, OCIDateTimeGetTime(envhp, hndl->errhp, dt, &hour, &minute, &second, &fsec));
+        f.year = year;
+        f.month = month;
+        f.day = day;
+        f.hour = hour;
+        f.minute = minute;
+        f.second = second;
+        f.nanosecond = fsec;
+        if (hndl->vptr->dty == SQLT_TIMESTAMP) {
+            f.zone_offset = local_zone_offset(&f);
+        } else {
+            sb1 tzh, tzm;
+
+            chkerr(hndl, OCIDateTimeGetTimeZoneOffset(envhp, hndl->errhp, dt, &tzh, &tzm));
+            f.zone_offset = tzh * 3600L + tzm * 60L;
+        }
+        if (hndl->vptr->dty == SQLT_TIMESTAMP_LTZ) {
+            /* a point of time */
+            return Scm_MakeTime(SCM_FALSE, local_seconds(&f) - f.zone_offset, f.nanosecond);
+        }
+        return make_date(&f);
+    }
+}
+
+
+/*
+ * BIND_CLOB and BIND_BLOB
+ *
+ * valuep is an array of LOB locators. A fetched locator is copied to
+ * an <oracle-lob>, which reads the value on demand.
+ */
+
+static void lob_init(bind_handle_t *hndl, u_int size)
+{
+    hndl->value_sz = sizeof(OCILobLocator*);
+}
+
+static int lob_setup(bind_handle_t *hndl)
+{
+    OCILobLocator **locs = hndl->valuep;
+    ub4 idx;
+
+    for (idx = 0; idx < hndl->max_rows; idx++) {
+        if (OCIDescriptorAlloc(envhp, (dvoid**)&locs[idx], OCI_DTYPE_LOB, 0, NULL) != OCI_SUCCESS) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void lob_clear(bind_handle_t *hndl)
+{
+    OCILobLocator **locs = hndl->valuep;
+    ub4 idx;
+
+    if (locs == NULL) {
+        return;
+    }
+    for (idx = 0; idx < hndl->max_rows; idx++) {
+        if (locs[idx] != NULL) {
+            Scm_oracle_lob_free_temporary(hndl->stmt, locs[idx]);
+            OCIDescriptorFree(locs[idx], OCI_DTYPE_LOB);
+            locs[idx] = NULL;
+        }
+    }
+}
+
+static void lob_set(bind_handle_t *hndl, ub4 idx, ScmObj val)
+{
+    if (SCM_NULLP(val)) {
+        hndl->ind[idx] = -1;
+    } else {
+        OCILobLocator **locs = hndl->valuep;
+
+        Scm_oracle_lob_free_temporary(hndl->stmt, locs[idx]);
+        Scm_oracle_lob_assign(hndl->stmt, val, &locs[idx]);
+        hndl->ind[idx] = 0;
+    }
+}
+
+static ScmObj lob_get(bind_handle_t *hndl, ub4 idx)
+{
+    if (hndl->ind[idx]) {
+        return SCM_NIL;
+    } else {
+        return Scm_oracle_make_lob(hndl->stmt, ((OCILobLocator**)hndl->valuep)[idx], hndl->type);
+    }
+}
+
+
+/*
+ * BIND_LONG
+ *
+ * LONG and LONG RAW columns are defined with OCI_DYNAMIC_FETCH and
+ * fetched piecewise into a growing buffer of each row, so that a value
+ * of any length is fetched whole. LONG RAW is fetched as a hexadecimal
+ * string as before. The length of the last piece is in alen.
+ */
+
+typedef struct {
+    char *buf;
+    ub4 len; /* bytes of the pieces before the last one */
+    ub4 cap;
+} long_value_t;
+
+static void long_init(bind_handle_t *hndl, u_int size)
+{
+    hndl->value_sz = sizeof(long_value_t);
+}
+
+static int long_setup(bind_handle_t *hndl)
+{
+    hndl->alen = calloc(hndl->max_rows, sizeof(ub4));
+    return hndl->alen != NULL;
+}
+
+static void long_clear(bind_handle_t *hndl)
+{
+    long_value_t *vals = hndl->valuep;
+    ub4 idx;
+
+    if (vals == NULL) {
+        return;
+    }
+    for (idx = 0; idx < hndl->max_rows; idx++) {
+        free(vals[idx].buf);
+        vals[idx].buf = NULL;
+        vals[idx].cap = 0;
+    }
+}
+
+static void long_set(bind_handle_t *hndl, ub4 idx, ScmObj val)
+{
+    Scm_Error("LONG columns can't be bound");
+}
+
+static ScmObj long_get(bind_handle_t *hndl, ub4 idx)
+{
+    if (hndl->ind[idx]) {
+        return SCM_NIL;
+    } else {
+        long_value_t *v = &((long_value_t*)hndl->valuep)[idx];
+
+        return Scm_MakeString(v->buf, v->len + hndl->alen[idx], -1, SCM_STRING_COPYING);
+    }
+}
+
+/*
+ * Empties the values of a LONG column before a fetch. The buffers are
+ * kept for the next rows.
+ */
+void bind_handle_long_reset(bind_handle_t *hndl)
+{
+    long_value_t *vals = hndl->valuep;
+    ub4 idx;
+
+    for (idx = 0; idx < hndl->max_rows; idx++) {
+        vals[idx].len = 0;
+        hndl->alen[idx] = 0;
+    }
+}
+
+/*
+ * The callback of OCIDefineDynamic. It is called for each piece of the
+ * value of row iter and returns the free space of the row buffer,
+ * which is enlarged to hold at least one more piece.
+ */
+sb4 bind_handle_long_cb(dvoid *octxp, OCIDefine *defnp, ub4 iter, dvoid **bufpp,
+                        ub4 **alenp, ub1 *piecep, dvoid **indp, ub2 **rcodep)
+{
+    bind_handle_t *hndl = octxp;
+    long_value_t *v = &((long_value_t*)hndl->valuep)[iter];
+
+    /* add the length of the previous piece. */
+    v->len += hndl->alen[iter];
+    if (v->cap - v->len < LONG_DEFINE_SIZE) {
+        ub4 cap = v->cap ? v->cap : LONG_DEFINE_SIZE;
+        char *buf;
+
+        while (cap - v->len < LONG_DEFINE_SIZE) {
+            cap *= 2;
+        }
+        buf = realloc(v->buf, cap);
+        if (buf == NULL) {
+            return OCI_ERROR;
+        }
+        v->buf = buf;
+        v->cap = cap;
+    }
+    hndl->alen[iter] = v->cap - v->len;
+    *bufpp = v->buf + v->len;
+    *alenp = &hndl->alen[iter];
+    *indp = &hndl->ind[iter];
+    *rcodep = &hndl->rlen[iter];
+    return OCI_CONTINUE;
+}
+
+
 /*
  * Common part
  */
@@ -142,31 +655,198 @@ static const struct {
     enum dbd_oracle_bind_type type;
     bind_handle_vptr_t vptr;
 } bind_handle_vptr_map[] = {
-    {BIND_STRING,  {SQLT_LVC, str_init, str_clear, str_set, str_get}},
-    {BIND_INTEGER, {SQLT_INT, int_init, int_clear, int_set, int_get}},
-    {BIND_REAL,    {SQLT_FLT, flt_init, flt_clear, flt_set, flt_get}},
+    {BIND_STRING,  {SQLT_LVC, str_init, NULL, str_clear, str_set, str_get}},
+    {BIND_INTEGER, {SQLT_INT, int_init, NULL, int_clear, int_set, int_get}},
+    {BIND_REAL,    {SQLT_FLT, flt_init, NULL, flt_clear, flt_set, flt_get}},
+    {BIND_BFLOAT,  {SQLT_BFLOAT, bflt_init, NULL, bflt_clear, bflt_set, bflt_get}},
+    {BIND_BDOUBLE, {SQLT_BDOUBLE, flt_init, NULL, flt_clear, flt_set, flt_get}},
+    {BIND_DATE,    {SQLT_ODT, dat_init, NULL, dat_clear, dat_set, dat_get}},
+    {BIND_TIMESTAMP,     {SQLT_TIMESTAMP, ts_init, ts_setup, ts_clear, ts_set, ts_get}},
+    {BIND_TIMESTAMP_TZ,  {SQLT_TIMESTAMP_TZ, ts_init, ts_setup, ts_clear, ts_set, ts_get}},
+    {BIND_TIMESTAMP_LTZ, {SQLT_TIMESTAMP_LTZ, ts_init, ts_setup, ts_clear, ts_set, ts_get}},
+    {BIND_CLOB,    {SQLT_CLOB, lob_init, lob_setup, lob_clear, lob_set, lob_get}},
+    {BIND_BLOB,    {SQLT_BLOB, lob_init, lob_setup, lob_clear, lob_set, lob_get}},
+    {BIND_LONG,    {SQLT_LNG, long_init, long_setup, long_clear, long_set, long_get}},
 };
 
 #define NUM_BIND_HANDLE_VPTR_MAP (sizeof(bind_handle_vptr_map)/sizeof(bind_handle_vptr_map[0]))
 
-void bind_handle_init(bind_handle_t *hndl, int type, u_int size)
+static const bind_handle_vptr_t *lookup_vptr(int type)
 {
     int idx;
-    const bind_handle_vptr_t *vptr;
 
     for (idx = 0; idx < NUM_BIND_HANDLE_VPTR_MAP; idx++) {
         if (type == bind_handle_vptr_map[idx].type) {
-	    break;
+	    return &bind_handle_vptr_map[idx].vptr;
 	}
     }
-    if (idx == NUM_BIND_HANDLE_VPTR_MAP) {
-        Scm_Error("unknown data type: %d", type);
+    Scm_Error("unknown data type: %d", type);
+    return NULL; /* not reached */
+}
+
+/*
+ * Returns the bind type of a <date> or <time>, or -1 for other values.
+ * A <date> without fractional seconds is bound as DATE so that it is
+ * compared with DATE columns without implicit conversion. A <time> is
+ * bound as TIMESTAMP WITH TIME ZONE in UTC.
+ */
+int bind_handle_date_type(ScmObj val)
+{
+    if (SCM_TIMEP(val)) {
+        return BIND_TIMESTAMP_TZ;
+    }
+    if (!SCM_FALSEP(Scm_ApplyRec(date_proc(&proc_date_p, "date?"), SCM_LIST1(val)))) {
+        if (date_field(&proc_date_nanosecond, "date-nanosecond", val) == 0) {
+            return BIND_DATE;
+        }
+        return BIND_TIMESTAMP;
+    }
+    return -1;
+}
+
+/*
+ * Returns TRUE when the handle already holds rows values of the type
+ * and size. Otherwise *size and *rows are enlarged geometrically if the
+ * handle has the same type, so that a growing value doesn't make the
+ * caller reallocate the buffers on every execution.
+ */
+int bind_handle_reusable(bind_handle_t *hndl, int type, u_int *size, ub4 *rows)
+{
+    bind_handle_t tmp;
+
+    if (hndl->vptr == NULL || hndl->type != type) {
+        return FALSE;
+    }
+    memset(&tmp, 0, sizeof(tmp));
+    hndl->vptr->init(&tmp, *size);
+    if (tmp.value_sz <= hndl->value_sz && *rows <= hndl->max_rows) {
+        return TRUE;
+    }
+    if (*size < (u_int)hndl->value_sz * 2) {
+        *size = hndl->value_sz * 2;
+    }
+    if (*rows < hndl->max_rows) {
+        *rows = hndl->max_rows;
+    }
+    return FALSE;
+}
+
+/*
+ * Sets the data type and the number of rows of the handle without
+ * allocating buffers. value_sz is available after this.
+ */
+void bind_handle_prepare(bind_handle_t *hndl, OCIError *errhp, int type, u_int size, ub4 rows)
+{
+    const bind_handle_vptr_t *vptr = lookup_vptr(type);
+
+    if (rows == 0) {
+        rows = 1;
+    }
+    bind_handle_clear(hndl);
+    vptr->init(hndl, size);
+    hndl->errhp = errhp;
+    hndl->max_rows = rows;
+    hndl->type = type;
+    hndl->size = size;
+    hndl->vptr = vptr;
+}
+
+/*
+ * Attaches buffers of max_rows rows to a prepared handle and sets up
+ * their values. Returns FALSE without raising an error when the values
+ * can't be set up; the handle is cleared then.
+ */
+static int attach(bind_handle_t *hndl, void *valuep, sb2 *ind, ub2 *rlen)
+{
+    ub4 row;
+
+    hndl->valuep = valuep;
+    hndl->ind = ind;
+    hndl->rlen = rlen;
+    for (row = 0; row < hndl->max_rows; row++) {
+        hndl->ind[row] = -1;
+    }
+    if (hndl->vptr->setup != NULL && !hndl->vptr->setup(hndl)) {
+        bind_handle_clear(hndl);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Attaches buffers of max_rows rows to a prepared handle. The buffers
+ * are owned by the caller unless they were allocated by bind_handle_init.
+ */
+void bind_handle_attach(bind_handle_t *hndl, void *valuep, sb2 *ind, ub2 *rlen)
+{
+    ub4 rows = hndl->max_rows;
+
+    if (!attach(hndl, valuep, ind, rlen)) {
+        Scm_Error("failed to set up %u rows", rows);
+    }
+}
+
+/*
+ * Allocates buffers owned by a prepared handle. Returns FALSE without
+ * raising an error when they can't be allocated, so that it can be
+ * called from an OCI callback; the handle is cleared then.
+ */
+int bind_handle_try_alloc(bind_handle_t *hndl)
+{
+    ub4 rows = hndl->max_rows;
+    void *valuep;
+    sb2 *ind;
+    ub2 *rlen;
+
+    valuep = calloc(rows, hndl->value_sz);
+    ind = malloc(rows * sizeof(sb2));
+    rlen = calloc(rows, sizeof(ub2));
+    if (valuep == NULL || ind == NULL || rlen == NULL) {
+        free(valuep);
+        free(ind);
+        free(rlen);
+        bind_handle_clear(hndl);
+        return FALSE;
     }
+    hndl->own_buffers = TRUE;
+    return attach(hndl, valuep, ind, rlen);
+}
+
+/*
+ * Allocates buffers owned by a prepared handle.
+ */
+void bind_handle_alloc(bind_handle_t *hndl)
+{
+    ub4 rows = hndl->max_rows;
+    sb4 value_sz = hndl->value_sz;
+
+    if (!bind_handle_try_alloc(hndl)) {
+        Scm_Error("failed to allocate %u rows of %d bytes", rows, value_sz);
+    }
+}
+
+void bind_handle_init(bind_handle_t *hndl, OCIError *errhp, int type, u_int size, ub4 rows)
+{
+    bind_handle_prepare(hndl, errhp, type, size, rows);
+    bind_handle_alloc(hndl);
+}
+
+void bind_handle_clear(bind_handle_t *hndl)
+{
     if (hndl->vptr != NULL) {
         hndl->vptr->clear(hndl);
 	hndl->vptr = NULL;
     }
-    vptr = &bind_handle_vptr_map[idx].vptr;
-    vptr->init(hndl, size);
-    hndl->vptr = vptr;
+    if (hndl->own_buffers) {
+        free(hndl->valuep);
+        free(hndl->ind);
+        free(hndl->rlen);
+        hndl->own_buffers = FALSE;
+    }
+    free(hndl->alen);
+    hndl->alen = NULL;
+    hndl->valuep = NULL;
+    hndl->ind = NULL;
+    hndl->rlen = NULL;
+    hndl->max_rows = 0;
 }
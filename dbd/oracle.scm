@@ -34,12 +34,37 @@
 (define-module dbd.oracle
   (use dbi)
   (use gauche.sequence)
+  (use gauche.generator)
+  (use gauche.uvector)
+  (use gauche.vport)
+  (use gauche.threads)
   (use util.relation)
   (use util.match)
   (use util.list)
   (use srfi-13)
+  (use srfi-19)
   (use srfi-43)
   (export <oracle-driver> <oracle-connection> <oracle-query> <oracle-result>
+          <oracle-pool> make-oracle-pool oracle-pool-stats
+          oracle-query-round-trips oracle-session-round-trips
+          dbi-execute-batch oracle-statement-cache-stats
+          dbi-commit dbi-rollback call-with-transaction
+          oracle-autocommit? oracle-set-autocommit!
+          oracle-result-fetch-columns oracle-result->columns
+          oracle-result-fetch-row oracle-result-fetch-rows
+          oracle-result-fetch-rows! oracle-execute-named
+          <oracle-stats> oracle-query-stats oracle-connection-stats
+          oracle-reset-stats! oracle-set-slow-statement-hook!
+          oracle-result-scroll oracle-result-position
+          <oracle-out-param> oracle-out oracle-in-out
+          oracle-out-value oracle-out-values
+          <oracle-loader> make-oracle-loader oracle-loader-load!
+          oracle-loader-load-columns! oracle-loader-finish!
+          oracle-loader-abort! oracle-loader-row-count
+          <oracle-lob> oracle-lob-length oracle-lob-chunk-size
+          open-oracle-lob-input-port oracle-clob oracle-blob
+          <oracle-async> oracle-execute-start oracle-async-poll
+          oracle-async-result oracle-async-wait
           ))
 
 (select-module dbd.oracle)
@@ -52,102 +77,895 @@
 
 (define-class <oracle-connection> (<dbi-connection>)
   ((con :init-keyword :con)
-   (err :init-keyword :err)))
+   (err :init-keyword :err)
+   ;; held while the connection and its error handle are used, so that
+   ;; threads can share the connection. See %with-connection-lock.
+   (lock :init-form (make-mutex))
+   ;; number of rows fetched by one round trip, used when dbi-prepare
+   ;; doesn't specify :fetch-size.
+   (fetch-size :init-keyword :fetch-size :init-value #f)
+   ;; OCI_ATTR_PREFETCH_ROWS and OCI_ATTR_PREFETCH_MEMORY of statements,
+   ;; used when dbi-prepare doesn't specify them. #f means OCI's default.
+   (prefetch-rows :init-keyword :prefetch-rows :init-value #f)
+   (prefetch-memory :init-keyword :prefetch-memory :init-value #f)
+   (stmt-cache :init-keyword :stmt-cache)
+   ;; nesting level of call-with-transaction
+   (transaction-depth :init-value 0)
+   ;; called with the SQL and the <oracle-stats> of an execution which
+   ;; takes slow-statement-threshold seconds or more.
+   (slow-statement-hook :init-keyword :slow-statement-hook :init-value #f)
+   (slow-statement-threshold :init-keyword :slow-statement-threshold :init-value 0)))
+
+;; Cache of prepared SQL texts, which keeps the same statements as the
+;; OCI statement cache of the connection. OCI caches statement handles
+;; and this caches what the driver computes before preparing them.
+(define-class <oracle-stmt-cache> ()
+  ((size   :init-keyword :size)
+   ;; sql -> #(rewritten-sql bind-count sql bind-names prev next)
+   (table  :init-form (make-hash-table 'string=?))
+   ;; the entries linked from the most recently used one by next and
+   ;; from the least recently used one by prev, around this head.
+   (lru    :init-form (rlet1 head (make-vector 6 #f)
+                        (vector-set! head 4 head)
+                        (vector-set! head 5 head)))
+   (hits   :init-value 0)
+   (misses :init-value 0)
+   ;; the cache of a pool is shared by the threads using its connections.
+   (lock   :init-form (make-mutex))))
+
+(define *default-stmt-cache-size* 20)
+
+;; A session pool. dbi-connect with :pool gets a session from it and
+;; dbi-close returns the session to it.
+(define-class <oracle-pool> ()
+  ((pool :init-keyword :pool)
+   (err :init-keyword :err)
+   ;; shared by the connections from the pool.
+   (stmt-cache :init-keyword :stmt-cache)
+   (stmt-cache-size :init-keyword :stmt-cache-size)
+   (lock :init-form (make-mutex))
+   ;; number of sessions being got, which the pool isn't closed under.
+   (getting :init-value 0)
+   (gets-done :init-form (make-condition-variable))))
 
 (define-class <oracle-query> (<dbi-query>)
-  ())
+  ;; the SQL text passed to dbi-prepare.
+  ((sql :init-keyword :sql :init-value #f)
+   ;; the result of the last execution while it is being read.
+   (result :init-value #f)
+   ;; column names, set when the columns are defined at the first execution.
+   (columns :init-value #f)
+   ;; hash table from column names to their indexes.
+   (column-index :init-value #f)
+   ;; vector of the place holder names when they are bound by name.
+   (bind-names :init-keyword :bind-names :init-value #f)
+   ;; #t if the query is executed with a scrollable cursor.
+   (scrollable :init-keyword :scrollable :init-value #f)))
 
+;; Rows are fetched from the statement on demand while the result is
+;; iterated, so a result can be read only once unless its query is
+;; scrollable.
 (define-class <oracle-result> (<relation> <sequence>)
   ((columns :init-keyword :columns :init-value '#())
-   (rows    :init-keyword :rows :init-value '())))
+   (column-index :init-keyword :column-index)
+   (query   :init-keyword :query)
+   (err     :init-keyword :err)
+   ;; the statement to be fetched. #f after the last row or dbi-close,
+   ;; or only after dbi-close if the result is scrollable.
+   (stmt    :init-keyword :stmt :init-value #f)
+   (scrollable :init-keyword :scrollable :init-value #f)
+   ;; rows fetched in a batch and not read yet.
+   (pending :init-value '())))
 
 
 (define-condition-type <dbd-oracle-error> <dbi-error> #f
   (error-code))
 
-(define (%chkerr func . args)
-  (let1 result (apply func args)
-        (if (= (car result) 0)
-            (cdr result)
-            (let ((err (error->message (car result) (cdr result))))
-              (error <dbd-oracle-error>
-                     :error-code (car err)
-                     (cdr err))))))
+;; Calls THUNK holding the lock of the connection C. A connection has
+;; one error handle and one transaction, so the threads sharing it take
+;; turns; OCI would serialize their calls on the session anyway. The
+;; lock is reentrant for the thread holding it, which can call the
+;; other methods, including a slow statement hook, from THUNK.
+(define (%with-connection-lock c thunk)
+  (let1 lock (slot-ref c 'lock)
+    (if (eq? (mutex-state lock) (current-thread))
+        (thunk)
+        (with-locking-mutex lock thunk))))
+
+;; a result is fetched with the error handle of its connection.
+(define (%with-result-lock r thunk)
+  (%with-connection-lock (slot-ref (slot-ref r 'query) 'connection) thunk))
+
+;; called by the C functions to raise an error.
+(define (%raise-oracle-error code msg)
+  (error <dbd-oracle-error> :error-code code msg))
 
 (define-method dbi-make-connection ((d <oracle-driver>)
                                     (options <string>)
                                     (option-alist <list>)
                                     . args)
-  (let ([db (match option-alist
-                   [((maybe-db . #t) . rest) maybe-db]
-                   [else (assoc-ref option-alist "db" "")])]
-        [user (get-keyword :username args #f)]
-        [passwd (get-keyword :password args #f)]
-        [err (%chkerr make-oracle-error)]
-        )
+  (let* ([pool (get-keyword :pool args #f)]
+         [cache-size (if pool
+                         (slot-ref pool 'stmt-cache-size)
+                         (get-keyword :statement-cache-size args
+                                      *default-stmt-cache-size*))]
+         [err (make-oracle-error)]
+         [con (if pool
+                  (%oracle-pool-connect pool err)
+                  (oracle-connect err
+                                  (get-keyword :username args #f)
+                                  (get-keyword :password args #f)
+                                  (%option-alist->db option-alist)))])
+    (oracle-set-stmt-cache-size! err con cache-size)
+    (oracle-svcctx-set-autocommit! err con (get-keyword :autocommit args #t))
     (make <oracle-connection>
-      :con (%chkerr oracle-connect err user passwd db)
-      :err err)))
+      :con con
+      :err err
+      :stmt-cache (if pool
+                      (slot-ref pool 'stmt-cache)
+                      (make <oracle-stmt-cache> :size cache-size))
+      :fetch-size (get-keyword :fetch-size args #f)
+      :prefetch-rows (get-keyword :prefetch-rows args #f)
+      :prefetch-memory (get-keyword :prefetch-memory args #f)
+      :slow-statement-hook (get-keyword :slow-statement-hook args #f)
+      :slow-statement-threshold (get-keyword :slow-statement-threshold args 0))))
+
+(define (%option-alist->db option-alist)
+  (match option-alist
+         [((maybe-db . #t) . rest) maybe-db]
+         [else (assoc-ref option-alist "db" "")]))
+
+;; creates a session pool for the database of DSN.
+(define (make-oracle-pool dsn . args)
+  (receive (driver options option-alist) (dbi-parse-dsn dsn)
+    (let* ([err (make-oracle-error)]
+           [cache-size (get-keyword :statement-cache-size args
+                                    *default-stmt-cache-size*)]
+           [pool (oracle-pool-create err
+                                     (get-keyword :username args #f)
+                                     (get-keyword :password args #f)
+                                     (%option-alist->db option-alist)
+                                     (get-keyword :min args 1)
+                                     (get-keyword :max args 10)
+                                     (get-keyword :increment args 1)
+                                     (get-keyword :timeout args 0))])
+      (make <oracle-pool>
+        :pool pool
+        :err err
+        :stmt-cache (make <oracle-stmt-cache> :size cache-size)
+        :stmt-cache-size cache-size))))
+
+;; returns an alist of the numbers of open and busy sessions, the
+;; number of sessions got from the pool and the total seconds spent
+;; waiting for them.
+(define-method oracle-pool-stats ((p <oracle-pool>))
+  (match (with-locking-mutex (slot-ref p 'lock)
+           (cut oracle-spool-stats (slot-ref p 'err) (slot-ref p 'pool)))
+    [(open busy gets wait-time)
+     `((open . ,open) (busy . ,busy) (gets . ,gets) (wait-time . ,wait-time))]))
+
+(define-method dbi-open? ((p <oracle-pool>))
+  (if (slot-ref p 'err) #t #f))
+
+(define-method dbi-close ((p <oracle-pool>))
+  (let1 lock (slot-ref p 'lock)
+    (with-locking-mutex lock
+      (lambda ()
+        (and-let* ([err (slot-ref p 'err)])
+          (slot-set! p 'err #f)
+          ;; the sessions being got use the pool handle.
+          (let wait ()
+            (when (> (slot-ref p 'getting) 0)
+              (mutex-unlock! lock (slot-ref p 'gets-done))
+              (mutex-lock! lock)
+              (wait)))
+          (guard (e (else (oracle-error-close err) (raise e)))
+            (oracle-pool-close err (slot-ref p 'pool))
+            (oracle-error-close err)))))))
+
+;; gets a session from the pool P. OCISessionGet may wait for a free
+;; session, so it is called without the lock of the pool; dbi-close
+;; waits for it instead.
+(define (%oracle-pool-connect p err)
+  (let ([lock (slot-ref p 'lock)]
+        [pool (slot-ref p 'pool)])
+    (with-locking-mutex lock
+      (lambda ()
+        (unless (slot-ref p 'err)
+          (error <dbi-error> "session pool is already closed:" p))
+        (inc! (slot-ref p 'getting))))
+    (unwind-protect
+        (rlet1 con (oracle-pool-connect err pool)
+          (with-locking-mutex lock (cut oracle-pool-count-get! err pool con)))
+      (with-locking-mutex lock
+        (lambda ()
+          (dec! (slot-ref p 'getting))
+          (condition-variable-broadcast! (slot-ref p 'gets-done)))))))
 
 ;; replace place holders to :1, :2, ...
 (define-method %replace-parameters ((sql <string>))
-  (let ((n 0))
-    (regexp-replace-all #/(--.*?\n|\/[*].*?[*]\/|\"[^\"]*\"|'[^']*'|\?)/
-                        sql
-                        (lambda (m)
-                          (let ((matched (rxmatch-substring m)))
-                            (if (string=? matched "?")
-                                (string-append ":" (x->string (inc! n)))
-                                matched))))))
+  (car (%parse-sql sql)))
+
+;; memoized results of oracle-parse-sql, which returns the SQL with
+;; place holders replaced and the list of the place holder names.
+(define *parsed-sql* (make-hash-table 'string=?))
+(define *parsed-sql-max* 1000)
+(define *parsed-sql-lock* (make-mutex))
+
+(define (%parse-sql sql)
+  (or (with-locking-mutex *parsed-sql-lock*
+        (cut hash-table-get *parsed-sql* sql #f))
+      (rlet1 parsed (oracle-parse-sql sql)
+        (with-locking-mutex *parsed-sql-lock*
+          (lambda ()
+            (when (>= (hash-table-num-entries *parsed-sql*) *parsed-sql-max*)
+              (set! *parsed-sql* (make-hash-table 'string=?)))
+            (hash-table-put! *parsed-sql* sql parsed))))))
+
+;; returns a vector of the place holder names if the SQL has named
+;; place holders such as :id. Otherwise #f.
+(define (%bind-names names)
+  (and (any (lambda (name) (not (string->number name))) names)
+       (list->vector names)))
 
 (define-method dbi-prepare ((c <oracle-connection>)
                             (sql <string>)
                             . args)
-  (let ((err (slot-ref c 'err))
-        (replaced-sql (%replace-parameters sql)))
-    (make <oracle-query> :connection c
-          :prepared (%chkerr oracle-stmt-prepare err replaced-sql))))
+  (%with-connection-lock c
+    (lambda ()
+      (let* ((con (slot-ref c 'con))
+             (err (slot-ref c 'err))
+             (cache (slot-ref c 'stmt-cache))
+             (stmt (cond
+                    [(%stmt-cache-lookup! cache sql)
+                     => (lambda (entry)
+                          (rlet1 stmt (oracle-stmt-prepare err con
+                                                           (vector-ref entry 0) (vector-ref entry 1))
+                            (and-let* ([names (vector-ref entry 3)])
+                              (oracle-stmt-set-bind-names! err stmt names))))]
+                    [else
+                     ;; the count of OCI decides whether the names
+                     ;; found by the lexer are binds; :new and :old in
+                     ;; the body of CREATE TRIGGER are not.
+                     (let* ([parsed (%parse-sql sql)]
+                            [stmt (oracle-stmt-prepare err con (car parsed) -1)]
+                            [names (and (positive? (oracle-stmt-bind-count err stmt))
+                                        (%bind-names (cdr parsed)))])
+                       (when names
+                         (oracle-stmt-set-bind-names! err stmt names))
+                       (%stmt-cache-add! cache sql (car parsed)
+                                         (oracle-stmt-bind-count err stmt) names)
+                       stmt)])))
+        (%oracle-stmt-set-options! c stmt args)
+        (make <oracle-query> :connection c
+              :sql sql
+              :prepared stmt
+              :bind-names (oracle-stmt-bind-names err stmt)
+              :scrollable (get-keyword :scrollable args #f))))))
+
+(define (%stmt-cache-lookup! cache sql)
+  (with-locking-mutex (slot-ref cache 'lock)
+    (lambda ()
+      (let1 entry (hash-table-get (slot-ref cache 'table) sql #f)
+        (cond [entry
+               (inc! (slot-ref cache 'hits))
+               (%lru-unlink! entry)
+               (%lru-push! (slot-ref cache 'lru) entry)
+               entry]
+              [else
+               (inc! (slot-ref cache 'misses))
+               #f])))))
+
+;; adds an entry, evicting the least recently used one when full.
+(define (%stmt-cache-add! cache sql replaced-sql bind-count names)
+  (with-locking-mutex (slot-ref cache 'lock)
+    (lambda ()
+      (let ([table (slot-ref cache 'table)]
+            [size (slot-ref cache 'size)])
+        (when (> size 0)
+          (and-let* ([old (hash-table-get table sql #f)])
+            (%lru-unlink! old)
+            (hash-table-delete! table sql))
+          (when (>= (hash-table-num-entries table) size)
+            (let1 lru (vector-ref (slot-ref cache 'lru) 4)
+              (%lru-unlink! lru)
+              (hash-table-delete! table (vector-ref lru 2))))
+          (let1 entry (vector replaced-sql bind-count sql names #f #f)
+            (%lru-push! (slot-ref cache 'lru) entry)
+            (hash-table-put! table sql entry)))))))
+
+;; the entries of the statement cache are in a doubly linked list, so
+;; that one is moved to the front on a hit and the last one is evicted
+;; without looking at the others.
+(define (%lru-unlink! entry)
+  (let ([prev (vector-ref entry 4)]
+        [next (vector-ref entry 5)])
+    (vector-set! prev 5 next)
+    (vector-set! next 4 prev)))
+
+(define (%lru-push! head entry)
+  (let1 next (vector-ref head 5)
+    (vector-set! entry 4 head)
+    (vector-set! entry 5 next)
+    (vector-set! next 4 entry)
+    (vector-set! head 5 entry)))
+
+;; returns an alist of the statistics of the statement cache.
+(define-method oracle-statement-cache-stats ((c <oracle-connection>))
+  (let1 cache (slot-ref c 'stmt-cache)
+    (with-locking-mutex (slot-ref cache 'lock)
+      (lambda ()
+        `((size . ,(slot-ref cache 'size))
+          (count . ,(hash-table-num-entries (slot-ref cache 'table)))
+          (hits . ,(slot-ref cache 'hits))
+          (misses . ,(slot-ref cache 'misses)))))))
+
+;; applies the keyword options of dbi-prepare, falling back to the ones
+;; given to dbi-connect.
+(define (%oracle-stmt-set-options! c stmt args)
+  (let ((err (slot-ref c 'err)))
+    (and-let* ([n (get-keyword :fetch-size args (slot-ref c 'fetch-size))])
+      (oracle-stmt-set-fetch-size! err stmt n))
+    (and-let* ([n (get-keyword :prefetch-rows args (slot-ref c 'prefetch-rows))])
+      (oracle-stmt-set-prefetch-rows! err stmt n))
+    (and-let* ([n (get-keyword :prefetch-memory args (slot-ref c 'prefetch-memory))])
+      (oracle-stmt-set-prefetch-memory! err stmt n))
+    (when (get-keyword :scrollable args #f)
+      (oracle-stmt-set-scrollable! err stmt #t))))
+
+;; number of OCIStmtExecute and OCIStmtFetch calls made by the query.
+;; Each call costs at most one round trip; fetches served from the
+;; prefetch buffer cost none.
+(define-method oracle-query-round-trips ((q <oracle-query>))
+  (let1 c (slot-ref q 'connection)
+    (%with-connection-lock c
+      (cut oracle-stmt-round-trips (slot-ref c 'err) (slot-ref q 'prepared)))))
+
+;; 'SQL*Net roundtrips to/from client' of the session, as counted by
+;; the server. Needs the privilege to select v$mystat and v$statname.
+(define-method oracle-session-round-trips ((c <oracle-connection>))
+  (let1 r (dbi-do c "SELECT s.value FROM v$mystat s, v$statname n \
+                       WHERE s.statistic# = n.statistic# \
+                         AND n.name = 'SQL*Net roundtrips to/from client'")
+    (x->integer (vector-ref (car (relation-rows r)) 0))))
+
+;;
+;; Statistics
+;;
+
+;; Returns an <oracle-stats> of the counters of the query since it is
+;; prepared: the seconds spent in prepare, execute and fetch calls,
+;; the numbers of executes, fetches, rows, bytes, reallocated bind and
+;; fetch buffers and round trips.
+(define-method oracle-query-stats ((q <oracle-query>))
+  (let1 c (slot-ref q 'connection)
+    (%with-connection-lock c
+      (cut oracle-stmt-stats (slot-ref c 'err) (slot-ref q 'prepared)))))
+
+;; Returns an <oracle-stats> of the totals of the queries prepared by
+;; the connection.
+(define-method oracle-connection-stats ((c <oracle-connection>))
+  (%with-connection-lock c
+    (cut oracle-svcctx-stats (slot-ref c 'err) (slot-ref c 'con))))
+
+(define-method oracle-reset-stats! ((q <oracle-query>))
+  (let1 c (slot-ref q 'connection)
+    (%with-connection-lock c
+      (cut oracle-stmt-reset-stats! (slot-ref c 'err) (slot-ref q 'prepared)))))
+
+(define-method oracle-reset-stats! ((c <oracle-connection>))
+  (%with-connection-lock c
+    (cut oracle-svcctx-reset-stats! (slot-ref c 'err) (slot-ref c 'con))))
+
+;; Sets PROC to be called with the SQL text and the <oracle-stats> of
+;; each execution which takes THRESHOLD seconds or more, including the
+;; fetches of its result. #f as PROC removes the hook.
+(define-method oracle-set-slow-statement-hook! ((c <oracle-connection>) threshold proc)
+  (slot-set! c 'slow-statement-threshold threshold)
+  (slot-set! c 'slow-statement-hook proc))
+
+;; calls the slow statement hook if the last execution of Q was slow.
+(define (%check-slow-statement q)
+  (let1 c (slot-ref q 'connection)
+    (and-let* ([hook (slot-ref c 'slow-statement-hook)]
+               [err (slot-ref c 'err)]
+               [stmt (slot-ref q 'prepared)]
+               [stats (oracle-stmt-last-stats err stmt)]
+               [(>= (+ (slot-ref stats 'prepare-time)
+                       (slot-ref stats 'execute-time)
+                       (slot-ref stats 'fetch-time))
+                    (slot-ref c 'slow-statement-threshold))])
+      (hook (slot-ref q 'sql) stats))))
 
 (define-method dbi-execute-using-connection ((c <oracle-connection>)
                                              (q <oracle-query>)
                                              (params <list>))
-  (let* ((con (slot-ref c 'con))
-         (err (slot-ref c 'err))
+  (%with-connection-lock c
+    (lambda ()
+      (%oracle-bind-for-execute! c q params)
+      (oracle-stmt-execute (slot-ref c 'err) (slot-ref c 'con) (slot-ref q 'prepared))
+      (%oracle-executed c q params))))
+
+;; binds the parameters of an execution of Q after closing the result
+;; of the last one.
+(define (%oracle-bind-for-execute! c q params)
+  (let* ((err (slot-ref c 'err))
          (stmt (slot-ref q 'prepared))
-         (req (%chkerr oracle-stmt-bind-count err stmt))
+         (req (oracle-stmt-bind-count err stmt))
          (len (length params)))
     (unless (= req len)
             (errorf <dbi-parameter-error>
                     "wrong-number of arguments: query requires ~d, but got ~d"
                     req len))
-    (%oracle-stmt-bind-params! err stmt params)
-    (%chkerr oracle-stmt-execute err con stmt)
-    (if (= (%chkerr oracle-stmt-type err stmt) OCI_STMT_SELECT)
-        (%make-oracle-result err stmt)
-        (%chkerr oracle-stmt-row-count err stmt))))
+    (and-let* ([r (slot-ref q 'result)])
+      (slot-set! q 'result #f)
+      (dbi-close r))
+    (oracle-stmt-reset-last-stats! err stmt)
+    (%oracle-stmt-bind-params! err stmt params)))
+
+;; returns the result of an executed query, or the number of rows
+;; processed by another statement.
+(define (%oracle-executed c q params)
+  (let ((err (slot-ref c 'err))
+        (stmt (slot-ref q 'prepared)))
+    (if (= (oracle-stmt-type err stmt) OCI_STMT_SELECT)
+        (rlet1 r (%make-oracle-result q err stmt)
+          (slot-set! q 'result r))
+        (rlet1 count (oracle-stmt-row-count err stmt)
+          (%read-out-params! err stmt params)
+          (%check-slow-statement q)))))
+
+;; Executes a query with named place holders such as :id. BINDINGS is
+;; a list of names and values: (oracle-execute-named q :id 1 :name "x").
+;; Names are compared case-insensitively.
+(define-method oracle-execute-named ((q <oracle-query>) . bindings)
+  (let ([names (or (slot-ref q 'bind-names)
+                   (error <dbi-parameter-error> "query has no named place holders:" q))]
+        [alist (let loop ([bindings bindings] [alist '()])
+                 (match bindings
+                   [() alist]
+                   [(name value . rest)
+                    (loop rest (acons (string-upcase (if (keyword? name)
+                                                         (keyword->string name)
+                                                         (x->string name)))
+                                      value alist))]
+                   [_ (error <dbi-parameter-error> "odd number of bindings:" bindings)]))])
+    (apply dbi-execute q
+           (map (lambda (name)
+                  (cond [(assoc name alist) => cdr]
+                        [else (error <dbi-parameter-error> "no value for place holder:" name)]))
+                (vector->list names)))))
+
+;;
+;; Nonblocking execution
+;;
+
+;; An execution started by oracle-execute-start. Its connection is in
+;; nonblocking mode and locked until the statement is executed and, for
+;; a query, the first batch of rows is fetched.
+(define-class <oracle-async> ()
+  ((query  :init-keyword :query)
+   (params :init-keyword :params)
+   ;; execute, fetch or done
+   (state  :init-value 'execute)
+   ;; #t while the lock of the connection is held for the execution.
+   (locked :init-value #f)
+   ;; the result or the row count, or the condition raised.
+   (value  :init-value #f)
+   (error  :init-value #f)))
+
+;; Starts executing Q with PARAMS and returns an <oracle-async> without
+;; waiting for the server. The execution proceeds as it is polled by
+;; oracle-async-poll or waited for by oracle-async-wait, in the thread
+;; which started it. The connection can't be used for anything else
+;; until then. Scrollable queries are executed but not fetched.
+(define-method oracle-execute-start ((q <oracle-query>) . params)
+  (let* ([c (slot-ref q 'connection)]
+         [lock (slot-ref c 'lock)]
+         [a (make <oracle-async> :query q :params params)])
+    (unless (eq? (mutex-state lock) (current-thread))
+      (mutex-lock! lock)
+      (slot-set! a 'locked #t))
+    (%async-step! a
+      (lambda ()
+        (%oracle-bind-for-execute! c q params)
+        (oracle-svcctx-set-nonblocking! (slot-ref c 'err) (slot-ref c 'con) #t)
+        (when (oracle-stmt-execute-start (slot-ref c 'err) (slot-ref c 'con) (slot-ref q 'prepared))
+          (%async-executed! a))))
+    a))
+
+;; Makes progress on A without waiting. Returns #t when it is done.
+(define-method oracle-async-poll ((a <oracle-async>))
+  (let* ([q (slot-ref a 'query)]
+         [c (slot-ref q 'connection)]
+         [stmt (slot-ref q 'prepared)])
+    (case (slot-ref a 'state)
+      [(execute)
+       (%async-step! a
+         (lambda ()
+           (when (oracle-stmt-execute-poll (slot-ref c 'err) (slot-ref c 'con) stmt)
+             (%async-executed! a))))]
+      [(fetch)
+       (%async-step! a
+         (lambda ()
+           (when (oracle-stmt-fetch-poll (slot-ref c 'err) stmt)
+             (slot-set! a 'state 'done))))])
+    (eq? (slot-ref a 'state) 'done)))
+
+;; Waits for A and returns what dbi-execute would have: a result for a
+;; query and the number of rows processed otherwise.
+(define-method oracle-async-result ((a <oracle-async>))
+  (car (oracle-async-wait (list a))))
+
+;; Waits until all of ASYNCS, which are started on different
+;; connections, are done, polling them in turn so that their waits for
+;; the servers overlap. Returns the list of their values as
+;; oracle-async-result does. If some of them failed, the error of the
+;; first one is raised after all are done.
+(define (oracle-async-wait asyncs)
+  (let loop ([pending asyncs]
+             [sleep 50000])
+    (let1 rest (remove oracle-async-poll pending)
+      (unless (null? rest)
+        (sys-nanosleep sleep)
+        ;; poll again soon after some completed, less often otherwise.
+        (loop rest (if (< (length rest) (length pending)) 50000 (min (* sleep 2) 5000000))))))
+  (map (lambda (a)
+         (cond [(slot-ref a 'error) => raise]
+               [else (slot-ref a 'value)]))
+       asyncs))
+
+;; called when the statement of A is executed. A query goes on to
+;; fetch its first batch of rows.
+(define (%async-executed! a)
+  (let* ([q (slot-ref a 'query)]
+         [c (slot-ref q 'connection)]
+         [err (slot-ref c 'err)]
+         [stmt (slot-ref q 'prepared)])
+    (cond [(and (= (oracle-stmt-type err stmt) OCI_STMT_SELECT)
+                (not (slot-ref q 'scrollable)))
+           (slot-set! a 'value (%oracle-executed c q (slot-ref a 'params)))
+           (slot-set! a 'state 'fetch)
+           (when (oracle-stmt-fetch-start err stmt)
+             (slot-set! a 'state 'done))]
+          [else
+           ;; the slow statement hook may use the connection.
+           (oracle-svcctx-set-nonblocking! err (slot-ref c 'con) #f)
+           (slot-set! a 'value (%oracle-executed c q (slot-ref a 'params)))
+           (slot-set! a 'state 'done)])))
+
+;; calls THUNK to make progress on A. When A is done, or THUNK raises an
+;; error, the connection is put back into blocking mode and unlocked.
+(define (%async-step! a thunk)
+  (let1 c (slot-ref (slot-ref a 'query) 'connection)
+    (guard (e [else (slot-set! a 'error e)
+                    (slot-set! a 'state 'done)])
+      (thunk))
+    (when (eq? (slot-ref a 'state) 'done)
+      (guard (e [else (unless (slot-ref a 'error)
+                        (slot-set! a 'error e))])
+        (when (dbi-open? c)
+          (oracle-svcctx-set-nonblocking! (slot-ref c 'err) (slot-ref c 'con) #f)))
+      (when (slot-ref a 'locked)
+        (slot-set! a 'locked #f)
+        (mutex-unlock! (slot-ref c 'lock))))))
+
+;;
+;; Transactions
+;;
 
+(define-method oracle-autocommit? ((c <oracle-connection>))
+  (%with-connection-lock c
+    (cut oracle-svcctx-autocommit? (slot-ref c 'err) (slot-ref c 'con))))
+
+;; When autocommit is off, DMLs are not committed until dbi-commit.
+(define-method oracle-set-autocommit! ((c <oracle-connection>) autocommit)
+  (%with-connection-lock c
+    (cut oracle-svcctx-set-autocommit! (slot-ref c 'err) (slot-ref c 'con) autocommit)))
+
+(define-method dbi-commit ((c <oracle-connection>))
+  (%with-connection-lock c
+    (cut oracle-commit (slot-ref c 'err) (slot-ref c 'con))))
+
+(define-method dbi-rollback ((c <oracle-connection>))
+  (%with-connection-lock c
+    (cut oracle-rollback (slot-ref c 'err) (slot-ref c 'con))))
+
+;; Calls PROC with the connection with autocommit off. Commits when PROC
+;; returns and rolls back when it raises an error. A nested call joins
+;; the outer transaction. The other threads sharing the connection wait
+;; until PROC returns, so that their statements don't join it.
+(define-method call-with-transaction ((c <oracle-connection>) proc)
+  (%with-connection-lock c
+    (lambda ()
+      (if (> (slot-ref c 'transaction-depth) 0)
+          (proc c)
+          (let1 autocommit (oracle-autocommit? c)
+            (dynamic-wind
+                (lambda ()
+                  (inc! (slot-ref c 'transaction-depth))
+                  (oracle-set-autocommit! c #f))
+                (lambda ()
+                  (guard (e [else (dbi-rollback c) (raise e)])
+                    (receive results (proc c)
+                      (dbi-commit c)
+                      (apply values results))))
+                (lambda ()
+                  (dec! (slot-ref c 'transaction-depth))
+                  (when (dbi-open? c)
+                    (oracle-set-autocommit! c autocommit)))))))))
+
+;; Values other than numbers, strings, dates and times are bound as
+;; their string representation.
 (define-method %oracle-stmt-bind-params! ((err <oracle-error>)
                                           (stmt <oracle-stmt>)
                                           (params <list>))
-  (let loop ([params params]
-             [idx 0])
-    (if (null? params)
-        (undefined)
-        (let1 val (car params)
-              (cond
-               [(integer? val)
-                (oracle-stmt-bind-init err stmt idx BIND_INTEGER 0)
-                (oracle-stmt-bind-set! err stmt idx val)]
-               [(real? val)
-                (oracle-stmt-bind-init err stmt idx BIND_REAL 0)
-                (oracle-stmt-bind-set! err stmt idx val)]
-               [else (let1 str (x->string val)
-                           (oracle-stmt-bind-init err stmt idx BIND_STRING (string-size str))
-                           (oracle-stmt-bind-set! err stmt idx str))])
-              (loop (cdr params) (+ idx 1))))))
-
-(define (%make-oracle-result err stmt)
-  (let* ([params (%chkerr oracle-stmt-params err stmt)]
+  (cond [(every %oracle-bindable? params)
+         (oracle-stmt-bind-params! err stmt params)]
+        [(any (lambda (v) (or (is-a? v <oracle-out-param>) (is-a? v <oracle-lob-param>)
+                              (%table-value? v)))
+              params)
+         (for-each-with-index
+          (lambda (pos v)
+            (cond [(is-a? v <oracle-out-param>) (%oracle-stmt-bind-out! err stmt pos v)]
+                  [(is-a? v <oracle-lob-param>)
+                   (oracle-stmt-bind-lob! err stmt pos (slot-ref v 'type)
+                                          (%lob-param-port v))]
+                  [(%table-value? v)
+                   (receive (type size elems) (%table-bind-type v)
+                     (oracle-stmt-bind-table! err stmt pos type size (max 1 (size-of elems)) elems))]
+                  [else
+                   (oracle-stmt-bind-param! err stmt pos
+                                            (if (%oracle-bindable? v) v (x->string v)))]))
+          params)]
+        [else
+         (oracle-stmt-bind-params! err stmt
+                                   (map (lambda (v) (if (%oracle-bindable? v) v (x->string v)))
+                                        params))]))
+
+(define (%oracle-bindable? v)
+  (or (real? v) (string? v) (null? v) (time? v) (date? v) (is-a? v <oracle-lob>)))
+
+;; vectors, uniform vectors and non-empty lists are bound as PL/SQL
+;; index-by tables.
+(define (%table-value? v)
+  (or (vector? v) (uvector? v) (pair? v)))
+
+;; returns the bind type, the size and the elements of a table.
+;; s64vectors and f64vectors are bound without conversion.
+(define (%table-bind-type v)
+  (cond [(s64vector? v) (values BIND_INTEGER 0 v)]
+        [(f64vector? v) (values BIND_REAL 0 v)]
+        [else (%array-bind-type (coerce-to <list> v))]))
+
+;;
+;; OUT binds
+;;
+
+;; An OUT or IN OUT parameter passed to dbi-execute. VALUE is the input
+;; value of an IN OUT parameter before the execution and the output
+;; value after it. VALUES is the list of the values returned into a
+;; RETURNING INTO bind, one for each processed row.
+(define-class <oracle-out-param> ()
+  ((type   :init-keyword :type)
+   (size   :init-keyword :size)
+   ;; maximum number of elements of a PL/SQL index-by table, or #f
+   (max-length :init-keyword :max-length :init-value #f)
+   (in-out :init-keyword :in-out :init-value #f)
+   (value  :init-keyword :value :init-value '())
+   (values :init-value '())))
+
+(define %out-param-types
+  `((integer . ,BIND_INTEGER)
+    (real . ,BIND_REAL)
+    (string . ,BIND_STRING)
+    (binary-float . ,BIND_BFLOAT)
+    (binary-double . ,BIND_BDOUBLE)
+    (date . ,BIND_DATE)
+    (timestamp . ,BIND_TIMESTAMP)
+    (timestamp-tz . ,BIND_TIMESTAMP_TZ)
+    (timestamp-ltz . ,BIND_TIMESTAMP_LTZ)))
+
+;; bytes of the buffer of a string parameter unless :size is given.
+(define-constant %default-out-size 4000)
+
+(define (%out-param-type type)
+  (or (assq-ref %out-param-types type)
+      (error "oracle-out: unknown type:" type)))
+
+;; Makes an OUT parameter of TYPE, one of integer, real, string,
+;; binary-float, binary-double, date, timestamp, timestamp-tz and
+;; timestamp-ltz. :size is the maximum bytes of a string. With
+;; :max-length, it is a PL/SQL index-by table of up to that many
+;; elements.
+(define (oracle-out type . opts)
+  (let-keywords opts ([size %default-out-size]
+                      [max-length #f])
+    (make <oracle-out-param> :type (%out-param-type type) :size size
+          :max-length max-length)))
+
+;; Makes an IN OUT parameter whose input value is VALUE. The type is
+;; chosen from VALUE unless :type is given. A vector, a uniform vector
+;; or a list is a PL/SQL index-by table, which can grow up to
+;; :max-length elements.
+(define (oracle-in-out value . opts)
+  (let-keywords opts ([type #f]
+                      [size #f]
+                      [max-length #f])
+    (receive (vtype vsize)
+        (cond [(%table-value? value)
+               (receive (t s elems) (%table-bind-type value) (values t s))]
+              [(and (integer? value) (exact? value)) (values BIND_INTEGER 0)]
+              [(real? value) (values BIND_REAL 0)]
+              [(string? value) (values BIND_STRING (string-size value))]
+              [(time? value) (values BIND_TIMESTAMP_TZ 0)]
+              [(date? value)
+               (values (if (zero? (date-nanosecond value)) BIND_DATE BIND_TIMESTAMP) 0)]
+              [type (values #f 0)]
+              [else (error "oracle-in-out: :type is required for" value)])
+      (make <oracle-out-param>
+        :type (if type (%out-param-type type) vtype)
+        :size (or size (max vsize %default-out-size))
+        :max-length (and (%table-value? value)
+                         (max (or max-length 0) (size-of value) 1))
+        :in-out #t
+        :value value))))
+
+(define (%oracle-stmt-bind-out! err stmt pos p)
+  (let ([type (slot-ref p 'type)]
+        [size (slot-ref p 'size)]
+        [value (if (slot-ref p 'in-out) (slot-ref p 'value) '())])
+    (cond [(slot-ref p 'max-length)
+           => (lambda (max-length)
+                (oracle-stmt-bind-table! err stmt pos type size max-length
+                                         (cond [(null? value) '#()]
+                                               [(or (s64vector? value) (f64vector? value)) value]
+                                               [else (coerce-to <vector> value)])))]
+          [else (oracle-stmt-bind-out! err stmt pos type size value)])))
+
+(define (oracle-out-value p)
+  (slot-ref p 'value))
+
+(define (oracle-out-values p)
+  (slot-ref p 'values))
+
+;; reads the output values of the OUT parameters in PARAMS.
+(define (%read-out-params! err stmt params)
+  (for-each-with-index
+   (lambda (pos v)
+     (when (is-a? v <oracle-out-param>)
+       (let1 vals (map (cut oracle-stmt-bind-ref err stmt pos <>)
+                       (iota (oracle-stmt-bind-rows err stmt pos)))
+         (slot-set! v 'values vals)
+         (slot-set! v 'value (cond [(slot-ref v 'max-length) (list->vector vals)]
+                                   [(pair? vals) (car vals)]
+                                   [else '()])))))
+   params))
+
+;;
+;; LOBs
+;;
+
+;; CLOB and BLOB columns are fetched as <oracle-lob>s, which are read
+;; on demand through ports. A LOB can be read while its connection is
+;; open.
+
+;; Returns an input port which reads the LOB a chunk at a time. A CLOB
+;; is read as characters in the client character set and a BLOB as
+;; bytes.
+(define-method open-oracle-lob-input-port ((lob <oracle-lob>))
+  (let1 offset 1
+    (make <buffered-input-port>
+      :buffer-size (oracle-lob-buffer-size lob)
+      :fill (lambda (buf)
+              (match (oracle-lob-read! lob offset buf)
+                [(nbytes . n)
+                 (inc! offset n)
+                 (if (zero? nbytes) (eof-object) nbytes)])))))
+
+;; A CLOB or BLOB parameter passed to dbi-execute, whose value is read
+;; from SOURCE into a temporary LOB at the execution.
+(define-class <oracle-lob-param> ()
+  ((type   :init-keyword :type)
+   (source :init-keyword :source)))
+
+;; Makes a CLOB parameter from SOURCE, an input port or a string. A
+;; port is read a chunk at a time, so that a large value is written
+;; without being read into a string.
+(define (oracle-clob source)
+  (make <oracle-lob-param> :type BIND_CLOB :source source))
+
+;; Makes a BLOB parameter from SOURCE, an input port or a u8vector.
+(define (oracle-blob source)
+  (make <oracle-lob-param> :type BIND_BLOB :source source))
+
+(define (%lob-param-port p)
+  (let1 source (slot-ref p 'source)
+    (cond [(input-port? source) source]
+          [(string? source) (open-input-string source)]
+          [(u8vector? source) (open-input-uvector source)]
+          [else (error "input port, string or u8vector required, but got" source)])))
+
+;; Executes a DML query once for each parameter row in ROWS, which is
+;; a list or vector of lists or vectors, in one round trip.
+;; Returns two values: the number of processed rows and a list of
+;; (row-index error-code message) for the rows which failed.
+(define-method dbi-execute-batch ((q <oracle-query>) rows)
+  (%with-connection-lock (slot-ref q 'connection)
+    (lambda ()
+      (let* ((c (slot-ref q 'connection))
+             (con (slot-ref c 'con))
+             (err (slot-ref c 'err))
+             (stmt (slot-ref q 'prepared))
+             (req (oracle-stmt-bind-count err stmt))
+             (rows (map (cut coerce-to <vector> <>) (coerce-to <list> rows)))
+             (nrows (length rows)))
+        (when (= (oracle-stmt-type err stmt) OCI_STMT_SELECT)
+          (error <dbi-error> "dbi-execute-batch can't execute a query:" q))
+        (dolist (row rows)
+          (unless (= req (vector-length row))
+            (errorf <dbi-parameter-error>
+                    "wrong-number of arguments: query requires ~d, but got ~d"
+                    req (vector-length row))))
+        (if (null? rows)
+            (values 0 '())
+            (begin
+              (oracle-stmt-reset-last-stats! err stmt)
+              (dotimes (idx req)
+                (%oracle-stmt-bind-array! err stmt idx
+                                          (map (cut vector-ref <> idx) rows) nrows))
+              (let1 errors (oracle-stmt-execute-batch err con stmt nrows)
+                (%check-slow-statement q)
+                (values (oracle-stmt-row-count err stmt)
+                        (map (lambda (e) (list (car e) (cadr e) (cddr e))) errors)))))))))
+
+;; binds the values of a column of dbi-execute-batch as an array.
+(define (%oracle-stmt-bind-array! err stmt idx vals nrows)
+  (receive (type size vals) (%array-bind-type vals)
+    (oracle-stmt-bind-init err stmt idx type size nrows)
+    (let loop ([vals vals]
+               [row 0])
+      (unless (null? vals)
+        (oracle-stmt-bind-set! err stmt idx row (car vals))
+        (loop (cdr vals) (+ row 1))))))
+
+;; chooses the type in which every value of the list VALS fits. Returns
+;; the type, the size of a string and the values, which are converted
+;; to strings when they are bound as strings.
+(define (%array-bind-type vals)
+  (let1 non-null (remove null? vals)
+    (cond [(every exact-integer? non-null) (values BIND_INTEGER 0 vals)]
+          [(every real? non-null) (values BIND_REAL 0 vals)]
+          [(every date? non-null)
+           (values (if (every (lambda (d) (zero? (date-nanosecond d))) non-null)
+                       BIND_DATE
+                       BIND_TIMESTAMP)
+                   0 vals)]
+          [(every time? non-null) (values BIND_TIMESTAMP_TZ 0 vals)]
+          [else
+           (let1 strs (map (lambda (v) (if (null? v) v (x->string v))) vals)
+             (values BIND_STRING
+                     (fold (lambda (v n) (if (null? v) n (max n (string-size v))))
+                           0 strs)
+                     strs))])))
+
+(define (%make-oracle-result q err stmt)
+  (unless (and (slot-ref q 'columns)
+               (oracle-stmt-columns-defined? err stmt))
+    (let1 columns (%oracle-stmt-define-columns! err stmt)
+      (slot-set! q 'columns columns)
+      (slot-set! q 'column-index (%make-column-index columns))))
+  (make <oracle-result>
+    :columns (slot-ref q 'columns)
+    :column-index (slot-ref q 'column-index)
+    :query q
+    :err err
+    :stmt stmt
+    :scrollable (slot-ref q 'scrollable)))
+
+;; defines the columns by their metadata and returns their names.
+(define (%oracle-stmt-define-columns! err stmt)
+  (let* ([params (oracle-stmt-params err stmt)]
          [count (vector-length params)]
          [columns (make-vector count)])
     (let define-loop ([idx 0])
@@ -158,23 +976,171 @@
               (cond ((= data-type SQLT_NUM)
                      (if (and (not (zero? (slot-ref param 'precision)))
                               (zero? (slot-ref param 'scale)))
-                         (%chkerr oracle-stmt-column-init err stmt idx BIND_INTEGER 0)
-                         (%chkerr oracle-stmt-column-init err stmt idx BIND_REAL 0)))
-                    (else (%chkerr oracle-stmt-column-init err stmt idx BIND_STRING 4000)))
+                         (oracle-stmt-column-init err stmt idx BIND_INTEGER 0)
+                         (oracle-stmt-column-init err stmt idx BIND_REAL 0)))
+                    ((= data-type SQLT_IBFLOAT)
+                     (oracle-stmt-column-init err stmt idx BIND_BFLOAT 0))
+                    ((= data-type SQLT_IBDOUBLE)
+                     (oracle-stmt-column-init err stmt idx BIND_BDOUBLE 0))
+                    ((= data-type SQLT_DAT)
+                     (oracle-stmt-column-init err stmt idx BIND_DATE 0))
+                    ((= data-type SQLT_TIMESTAMP)
+                     (oracle-stmt-column-init err stmt idx BIND_TIMESTAMP 0))
+                    ((= data-type SQLT_TIMESTAMP_TZ)
+                     (oracle-stmt-column-init err stmt idx BIND_TIMESTAMP_TZ 0))
+                    ((= data-type SQLT_TIMESTAMP_LTZ)
+                     (oracle-stmt-column-init err stmt idx BIND_TIMESTAMP_LTZ 0))
+                    ((= data-type SQLT_CLOB)
+                     (oracle-stmt-column-init err stmt idx BIND_CLOB 0))
+                    ((= data-type SQLT_BLOB)
+                     (oracle-stmt-column-init err stmt idx BIND_BLOB 0))
+                    ((or (= data-type SQLT_LNG) (= data-type SQLT_LBI))
+                     (oracle-stmt-column-init err stmt idx BIND_LONG 0))
+                    (else (oracle-stmt-column-init err stmt idx BIND_STRING
+                                                   (slot-ref param 'define-size))))
               (define-loop (+ idx 1)))))
-    (let rows-loop ([rest? (%chkerr oracle-stmt-fetch err stmt)]
-                    [rows '()])
-      (if (not rest?)
-          (make <oracle-result>
-            :columns columns
-            :rows (reverse! rows))
-          (let1 row (make-vector count)
-                (let row-loop ([idx 0])
-                  (when (< idx count)
-                        (vector-set! row idx (%chkerr oracle-stmt-column-ref err stmt idx))
-                        (row-loop (+ idx 1))))
-                (rows-loop (%chkerr oracle-stmt-fetch err stmt)
-                           (cons row rows)))))))
+    (oracle-stmt-define-columns err stmt)
+    columns))
+
+;; fetches the next row of the result. Returns #f at the end.
+;; Rows are made in C a batch of the fetch size at a time, except for
+;; a scrollable result, whose position must follow the rows read.
+(define (%oracle-result-next-row r)
+  (cond [(pair? (slot-ref r 'pending))
+         (pop! (slot-ref r 'pending))]
+        [(slot-ref r 'stmt)
+         => (lambda (stmt)
+              (%with-result-lock r
+                (lambda ()
+                  (if (slot-ref r 'scrollable)
+                      (oracle-stmt-fetch-row (slot-ref r 'err) stmt #f)
+                      (match (oracle-stmt-fetch-rows (slot-ref r 'err) stmt 0)
+                        [() (%oracle-result-done! r) #f]
+                        [(row . rest) (slot-set! r 'pending rest) row])))))]
+        [else #f]))
+
+;; Reads the next row as a vector. ROW, a vector of the column count,
+;; is filled and returned instead of a new vector if it is given.
+;; Returns #f at the end.
+(define-method oracle-result-fetch-row ((r <oracle-result>) . maybe-row)
+  (define row (get-optional maybe-row #f))
+  (cond [(pair? (slot-ref r 'pending))
+         (%fill-row! row (pop! (slot-ref r 'pending)))]
+        [(slot-ref r 'stmt)
+         => (lambda (stmt)
+              (%with-result-lock r
+                (lambda ()
+                  (or (oracle-stmt-fetch-row (slot-ref r 'err) stmt row)
+                      (begin (%oracle-result-done! r) #f)))))]
+        [else #f]))
+
+;; Reads up to MAX rows, or a batch of the fetch size if MAX is
+;; omitted, as a list of vectors. Returns () at the end.
+(define-method oracle-result-fetch-rows ((r <oracle-result>) . maybe-max)
+  (define max (get-optional maybe-max 0))
+  (let1 pending (slot-ref r 'pending)
+    (cond [(pair? pending)
+           (receive (head tail) (split-at* pending (if (zero? max) (length pending) max))
+             (slot-set! r 'pending tail)
+             head)]
+          [(slot-ref r 'stmt)
+           => (lambda (stmt)
+                (%with-result-lock r
+                  (lambda ()
+                    (rlet1 rows (oracle-stmt-fetch-rows (slot-ref r 'err) stmt max)
+                      (when (null? rows)
+                        (%oracle-result-done! r))))))]
+          [else '()])))
+
+;; Reads rows into ROWS, a vector whose elements are filled with the
+;; rows. Elements which are vectors of the column count are reused.
+;; Returns the number of rows read, which is less than the length of
+;; ROWS at the end.
+(define-method oracle-result-fetch-rows! ((r <oracle-result>) (rows <vector>))
+  (let loop ([n 0])
+    (cond [(= n (vector-length rows)) n]
+          [(pair? (slot-ref r 'pending))
+           (vector-set! rows n (%fill-row! (vector-ref rows n) (pop! (slot-ref r 'pending))))
+           (loop (+ n 1))]
+          [(slot-ref r 'stmt)
+           => (lambda (stmt)
+                (%with-result-lock r
+                  (lambda ()
+                    (let1 m (if (zero? n)
+                                (oracle-stmt-fetch-rows! (slot-ref r 'err) stmt rows)
+                                (let1 rest (vector-copy rows n)
+                                  (rlet1 m (oracle-stmt-fetch-rows! (slot-ref r 'err) stmt rest)
+                                    (vector-copy! rows n rest))))
+                      (when (< (+ n m) (vector-length rows))
+                        (%oracle-result-done! r))
+                      (+ n m)))))]
+          [else n])))
+
+;; called when all rows of the result are read or it is closed.
+;; A scrollable result is kept open to be scrolled back.
+(define (%oracle-result-done! r)
+  (unless (slot-ref r 'scrollable)
+    (slot-set! r 'stmt #f)
+    (%check-slow-statement (slot-ref r 'query))))
+
+;;
+;; Scrollable results
+;;
+
+(define %fetch-orientations
+  `((current . ,OCI_FETCH_CURRENT)
+    (next . ,OCI_FETCH_NEXT)
+    (prior . ,OCI_FETCH_PRIOR)
+    (first . ,OCI_FETCH_FIRST)
+    (last . ,OCI_FETCH_LAST)
+    (absolute . ,OCI_FETCH_ABSOLUTE)
+    (relative . ,OCI_FETCH_RELATIVE)))
+
+(define (%scrollable-stmt r)
+  (unless (slot-ref r 'scrollable)
+    (error "oracle-result: query is not prepared with :scrollable #t:" r))
+  (or (slot-ref r 'stmt)
+      (error "oracle-result: result is already closed:" r)))
+
+;; Moves the cursor of a scrollable result and returns the row there
+;; as a vector, or #f if there is no such row. ORIENTATION is one of
+;; first, last, next, prior, current, absolute and relative. OFFSET is
+;; the position of the row, starting from 1, for absolute and the
+;; distance from the current row for relative.
+(define-method oracle-result-scroll ((r <oracle-result>) orientation . maybe-offset)
+  (let ([stmt (%scrollable-stmt r)]
+        [o (or (assq-ref %fetch-orientations orientation)
+               (error "oracle-result: invalid fetch orientation:" orientation))])
+    (%with-result-lock r
+      (cut oracle-stmt-scroll (slot-ref r 'err) stmt o (get-optional maybe-offset 0) #f))))
+
+;; Returns the position of the row read last, starting from 1, or 0
+;; before the first row is read.
+(define-method oracle-result-position ((r <oracle-result>))
+  (%with-result-lock r
+    (cut oracle-stmt-position (slot-ref r 'err) (%scrollable-stmt r))))
+
+;; A scrollable result is a random-access sequence. The rows are
+;; fetched around the one referred to, not all at once.
+(define-method ref ((r <oracle-result>) (k <integer>) . fallback)
+  (if (slot-ref r 'scrollable)
+      (or (and (>= k 0) (oracle-result-scroll r 'absolute (+ k 1)))
+          (get-optional fallback
+                        (error "oracle-result: index out of range:" k)))
+      (next-method)))
+
+;; The rows of a scrollable result are counted by fetching the last one.
+(define-method size-of ((r <oracle-result>))
+  (if (slot-ref r 'scrollable)
+      (if (oracle-result-scroll r 'last)
+          (oracle-result-position r)
+          0)
+      (next-method)))
+
+(define (%fill-row! dest src)
+  (if (and (vector? dest) (= (vector-length dest) (vector-length src)))
+      (begin (vector-copy! dest 0 src) dest)
+      src))
 
 (define-method dbi-open? ((c <oracle-connection>))
   (let1 con (slot-ref c 'con)
@@ -185,48 +1151,271 @@
         (if stmt #t #f)))
 
 (define-method dbi-open? ((r <oracle-result>))
-  (zero? (vector-length (slot-ref r 'columns))))
+  (if (slot-ref r 'stmt) #t #f))
 
 (define-method dbi-close ((c <oracle-connection>))
-  (let ((con (slot-ref c 'con))
-        (err (slot-ref c 'err)))
-    (slot-set! c 'con #f)
-    (slot-set! c 'err #f)
-    (guard (e (else (oracle-error-close err) (raise e)))
-           (%chkerr oracle-disconnect err con)
-           (oracle-error-close err))))
+  (%with-connection-lock c
+    (lambda ()
+      (let ((con (slot-ref c 'con))
+            (err (slot-ref c 'err)))
+        (slot-set! c 'con #f)
+        (slot-set! c 'err #f)
+        (guard (e (else (oracle-error-close err) (raise e)))
+               ;; OCILogoff commits the pending transaction. Discard it instead.
+               (unless (oracle-svcctx-autocommit? err con)
+                 (oracle-rollback err con))
+               (oracle-disconnect err con)
+               (oracle-error-close err))))))
 
 (define-method dbi-close ((q <oracle-query>))
   (let1 stmt (slot-ref q 'prepared)
         (slot-set! q 'prepared #f)
-        (oracle-stmt-close stmt)))
+        (%with-connection-lock (slot-ref q 'connection)
+          (cut oracle-stmt-close stmt))))
 
 (define-method dbi-close ((r <oracle-result>))
-  (unless (zero? (vector-length (slot-ref r 'columns)))
-          (slot-set! r 'columns '#())
-          (slot-set! r 'rows '()))
+  (slot-set! r 'pending '())
+  (when (slot-ref r 'stmt)
+    (%with-result-lock r
+      (lambda ()
+        (and-let* ([stmt (slot-ref r 'stmt)])
+          (slot-set! r 'stmt #f)
+          (oracle-stmt-cancel (slot-ref r 'err) stmt)
+          (%check-slow-statement (slot-ref r 'query))))))
   (undefined))
 
+;; A scrollable result is iterated from the first row, or the :start
+;; index, each time.
 (define-method call-with-iterator ((r <oracle-result>) proc . keys)
-  (apply call-with-iterator (slot-ref r 'rows) proc keys))
+  (let1 row (if (and (slot-ref r 'scrollable) (slot-ref r 'stmt))
+                (oracle-result-scroll r 'absolute (+ (get-keyword :start keys 0) 1))
+                (%oracle-result-next-row r))
+    (proc (lambda () (not row))
+          (lambda ()
+            (let1 current row
+              (set! row (%oracle-result-next-row r))
+              current)))))
+
+;; Reads the next batch of rows of the fetch size column by column.
+;; Returns two values: a vector of the columns and a vector of their
+;; null maps, u8vectors in which 1 means NULL. Integer and real columns
+;; are s64vectors and f64vectors without per-cell Scheme objects; the
+;; others are vectors. Returns #f and #f at the end.
+(define-method oracle-result-fetch-columns ((r <oracle-result>))
+  (let1 batch (%oracle-result-fetch-columns r)
+    (if (and batch (positive? (%batch-size batch)))
+        (values (car batch) (cdr batch))
+        (values #f #f))))
+
+;; Reads the rest of the rows column by column. Returns the same
+;; values as oracle-result-fetch-columns but for all the rows.
+(define-method oracle-result->columns ((r <oracle-result>))
+  (let loop ([batches '()])
+    (let1 batch (%oracle-result-fetch-columns r)
+      (if (and batch (or (null? batches) (positive? (%batch-size batch))))
+          (loop (cons batch batches))
+          (let1 batches (reverse! batches)
+            (if (null? batches)
+                (values #f #f)
+                (values (%concatenate-columns (map car batches))
+                        (%concatenate-columns (map cdr batches)))))))))
+
+(define (%oracle-result-fetch-columns r)
+  (and-let* ([stmt (slot-ref r 'stmt)])
+    (%with-result-lock r
+      (lambda ()
+        (rlet1 batch (oracle-stmt-fetch-columns (slot-ref r 'err) stmt)
+          (when (zero? (%batch-size batch))
+            (%oracle-result-done! r)))))))
+
+(define (%batch-size batch)
+  (if (zero? (vector-length (car batch)))
+      0
+      (size-of (vector-ref (cdr batch) 0))))
+
+;; concatenates a list of vectors of columns column by column.
+(define (%concatenate-columns batches)
+  (let1 count (vector-length (car batches))
+    (rlet1 columns (make-vector count)
+      (dotimes (idx count)
+        (vector-set! columns idx
+                     (%concatenate-vectors (map (cut vector-ref <> idx) batches)))))))
+
+(define (%concatenate-vectors vecs)
+  (receive (make copy!)
+      (cond [(s64vector? (car vecs)) (values make-s64vector s64vector-copy!)]
+            [(f64vector? (car vecs)) (values make-f64vector f64vector-copy!)]
+            [(u8vector? (car vecs)) (values make-u8vector u8vector-copy!)]
+            [else (values make-vector vector-copy!)])
+    (rlet1 dest (make (fold (lambda (v n) (+ n (size-of v))) 0 vecs))
+      (fold (lambda (v start)
+              (copy! dest start v)
+              (+ start (size-of v)))
+            0 vecs))))
+
+(define-method x->generator ((r <oracle-result>))
+  (lambda ()
+    (or (%oracle-result-next-row r) (eof-object))))
 
 (define-method relation-column-names ((r <oracle-result>))
   (slot-ref r 'columns))
 
+(define (%make-column-index columns)
+  (rlet1 index (make-hash-table 'string=?)
+    (dotimes (i (vector-length columns))
+      (hash-table-put! index (vector-ref columns i) i))))
+
+;; returns the index of COLUMN, a string or a symbol, or #f.
+(define (%column-index r column)
+  (hash-table-get (slot-ref r 'column-index)
+                  (if (symbol? column) (symbol->string column) column)
+                  #f))
+
 (define-method relation-accessor ((r <oracle-result>))
-  (let1 columns (slot-ref r 'columns)
-        (lambda (row column . maybe-default)
-          (cond
-           [(vector-index (cut string=? <> column) columns)
-            => (cut vector-ref row <>)]
-           [(pair? maybe-default) (car maybe-default)]
-           [else (error "oracle-result: invalid column:" column)]))))
+  (lambda (row column . maybe-default)
+    (cond
+     [(%column-index r column) => (cut vector-ref row <>)]
+     [(pair? maybe-default) (car maybe-default)]
+     [else (error "oracle-result: invalid column:" column)])))
+
+;; returns a procedure which takes a row and returns the value of
+;; COLUMN. The column is looked up only once.
+(define-method relation-column-getter ((r <oracle-result>) column)
+  (cond [(%column-index r column) => (lambda (idx) (cut vector-ref <> idx))]
+        [else (error "oracle-result: invalid column:" column)]))
 
+;; returns a lazy sequence of the rows which are not read yet.
 (define-method relation-rows ((r <oracle-result>))
-  (slot-ref r 'rows))
+  (generator->lseq (x->generator r)))
 
 (define-method relation-modifier ((r <oracle-result>))
   #f)
 
+;;
+;; Direct path loads
+;;
+
+;; A direct path load of a table, which writes the rows to data blocks
+;; without the SQL layer. The table is locked until the load is
+;; finished or aborted.
+(define-class <oracle-loader> ()
+  ((loader :init-keyword :loader)
+   (err :init-keyword :err)
+   ;; #f after the load is finished or aborted.
+   (open :init-value #t)
+   (column-count :init-keyword :column-count)
+   ;; alist of the indexes and date->string formats of the date and
+   ;; timestamp columns, whose values are loaded as strings.
+   (date-columns :init-keyword :date-columns)))
+
+;; type -> (bind-type default-size dateformat date->string-format)
+(define %loader-column-types
+  `((integer   ,BIND_INTEGER 0 #f #f)
+    (real      ,BIND_REAL 0 #f #f)
+    (string    ,BIND_STRING 4000 #f #f)
+    (date      ,BIND_STRING 19 "YYYY-MM-DD HH24:MI:SS" "~Y-~m-~d ~H:~M:~S")
+    (timestamp ,BIND_STRING 29 "YYYY-MM-DD HH24:MI:SS.FF9" "~Y-~m-~d ~H:~M:~S.~N")))
+
+;; Prepares a direct path load of TABLE on the connection C. COLUMNS
+;; is a list of (name type [size]), where type is one of integer,
+;; real, string, date and timestamp. :rows is the number of rows sent
+;; at a time and :buffer-size the bytes of the stream buffer; OCI's
+;; defaults are used unless they are given.
+(define (make-oracle-loader c table columns . opts)
+  (let-keywords opts ([schema #f]
+                      [rows 0]
+                      [buffer-size 0])
+    (let* ([specs (map (lambda (column)
+                         (match column
+                           [(name type . maybe-size)
+                            (match (or (assq type %loader-column-types)
+                                       (error "make-oracle-loader: invalid column type:" type))
+                              [(_ bind-type size fmt str-fmt)
+                               (list (x->string name) bind-type
+                                     (get-optional maybe-size size) fmt str-fmt)])]
+                           [_ (error "make-oracle-loader: (name type [size]) required, but got"
+                                     column)]))
+                       columns)]
+           ;; its own, as a loader is used without the connection's lock.
+           [err (make-oracle-error)])
+      (make <oracle-loader>
+        :loader (oracle-dirpath-prepare err (slot-ref c 'con)
+                                        (and schema (x->string schema))
+                                        (x->string table)
+                                        (map (cut take <> 4) specs)
+                                        rows buffer-size)
+        :err err
+        :column-count (length specs)
+        :date-columns (filter-map (lambda (spec idx)
+                                    (and (list-ref spec 4) (cons idx (list-ref spec 4))))
+                                  specs (iota (length specs)))))))
+
+;; converts the dates of the date and timestamp columns to strings.
+(define (%loader-date->string v fmt)
+  (if (date? v) (date->string v fmt) v))
+
+(define (%loader-convert-row l row)
+  (let1 row (if (vector? row) (vector-copy row) (list->vector row))
+    (dolist (col (slot-ref l 'date-columns) row)
+      (when (< (car col) (vector-length row))
+        (vector-set! row (car col)
+                     (%loader-date->string (vector-ref row (car col)) (cdr col)))))))
+
+;; Loads ROWS, a list or vector of rows, each of which is a list or a
+;; vector of the column values. '() is NULL. Returns the number of rows
+;; loaded so far.
+(define-method oracle-loader-load! ((l <oracle-loader>) rows)
+  (let1 rows (coerce-to <list> rows)
+    (oracle-dirpath-load-rows (%loader-err l) (slot-ref l 'loader)
+                              (if (null? (slot-ref l 'date-columns))
+                                  rows
+                                  (map (cut %loader-convert-row l <>) rows)))))
+
+;; Loads COLUMNS, a list or vector of the columns of the same length.
+;; An integer column may be an s64vector and a real column an
+;; f64vector, which are passed to OCI without conversion. MAYBE-NULLS
+;; is a list or vector of u8vectors in which 1 means NULL, as returned
+;; by oracle-result->columns.
+(define-method oracle-loader-load-columns! ((l <oracle-loader>) columns . maybe-nulls)
+  (let ([columns (list->vector
+                  (map (lambda (col idx)
+                         (cond [(assv idx (slot-ref l 'date-columns))
+                                => (lambda (p)
+                                     (map-to <vector> (cut %loader-date->string <> (cdr p)) col))]
+                               [(or (vector? col) (s64vector? col) (f64vector? col)) col]
+                               [else (coerce-to <vector> col)]))
+                       (coerce-to <list> columns)
+                       (iota (size-of columns))))]
+        [nulls (get-optional maybe-nulls #f)])
+    (oracle-dirpath-load-columns (%loader-err l) (slot-ref l 'loader) columns
+                                 (and nulls (coerce-to <vector> nulls)))))
+
+;; Saves the rows loaded and returns their number.
+(define-method oracle-loader-finish! ((l <oracle-loader>))
+  (rlet1 count (oracle-dirpath-finish (%loader-err l) (slot-ref l 'loader))
+    (slot-set! l 'open #f)))
+
+;; Discards the rows loaded.
+(define-method oracle-loader-abort! ((l <oracle-loader>))
+  (when (slot-ref l 'open)
+    (slot-set! l 'open #f)
+    (oracle-dirpath-abort (slot-ref l 'err) (slot-ref l 'loader)))
+  (undefined))
+
+(define-method oracle-loader-row-count ((l <oracle-loader>))
+  (oracle-dirpath-row-count (slot-ref l 'err) (slot-ref l 'loader)))
+
+(define-method dbi-open? ((l <oracle-loader>))
+  (slot-ref l 'open))
+
+;; A load which is not finished is aborted.
+(define-method dbi-close ((l <oracle-loader>))
+  (oracle-loader-abort! l))
+
+(define (%loader-err l)
+  (unless (slot-ref l 'open)
+    (error "oracle-loader: the load is already finished or aborted"))
+  (slot-ref l 'err))
+
 ;; Epilogue
 (provide "dbd/oracle")
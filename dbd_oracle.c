@@ -3,12 +3,30 @@
  */
 
 #include <stdlib.h>
+#include <sys/time.h>
 #include "dbd_oracle.h"
 #include <gauche/class.h>
+#include <gauche/uvector.h>
 
-#define ERROR(state, err) Scm_Cons(SCM_MAKE_INT(state), SCM_OBJ(err))
-#define ALLOC_ERROR(state) Scm_Cons(SCM_MAKE_INT(state), SCM_OBJ(Scm_make_oracle_env()))
-#define SUCCESS(obj) Scm_Cons(SCM_MAKE_INT(OCI_SUCCESS), SCM_OBJ(obj))
+#define RAISE_ERROR(state, err) Scm_oracle_raise_error((state), (err)->errhp, (err)->type)
+#define RAISE_ALLOC_ERROR(state) Scm_oracle_raise_error((state), envhp, OCI_HTYPE_ENV)
+
+/*
+ * Counters of a statement or a connection. The times are seconds
+ * spent in OCI calls, measured on the client.
+ */
+typedef struct {
+    double prepare_time; /* OCIStmtPrepare2 */
+    double execute_time; /* OCIStmtExecute */
+    double fetch_time;   /* OCIStmtFetch */
+    ub4 executes;
+    ub4 fetches;         /* number of OCIStmtFetch calls */
+    ub4 rows;            /* number of rows fetched */
+    u_long bytes;        /* bytes of the non-null values fetched */
+    ub4 bind_reallocs;   /* number of binds whose buffers were not reused */
+    ub4 define_reallocs; /* number of times the fetch buffers were allocated */
+    ub4 round_trips;     /* number of OCIStmtExecute and OCIStmtFetch calls */
+} oracle_stats_t;
 
 struct Scm_OCIError {
     SCM_HEADER;
@@ -19,15 +37,76 @@ struct Scm_OCIError {
 struct Scm_OCISvcCtx {
     SCM_HEADER;
     OCISvcCtx *svchp;
+    Scm_OCISPool *pool; /* the session pool which svchp is got from */
+    int autocommit;     /* commits each DML by OCI_COMMIT_ON_SUCCESS */
+    double get_time;    /* seconds spent in OCISessionGet to get svchp from the pool */
+    oracle_stats_t stats; /* totals of the statements prepared by the connection */
+};
+
+struct Scm_OCISPool {
+    SCM_HEADER;
+    OCISPool *spoolhp;
+    OraText *name;
+    ub4 name_len;
+    ub4 get_count;  /* number of sessions got from the pool */
+    double wait_time; /* total seconds spent in OCISessionGet */
 };
 
 struct Scm_OCIStmt {
     SCM_HEADER;
     OCIStmt *stmtp;
+    Scm_OCISvcCtx *svc; /* the connection which prepared stmtp */
+    Scm_OCIError *err;
     ub4 bind_count;
+    ScmObj bind_names; /* vector of placeholder names bound by name, or #f */
     ub4 column_count;
     bind_handle_t *bind_handles;
     bind_handle_t *column_handles;
+    void *column_arena; /* value, indicator and length buffers of column_handles */
+    size_t column_arena_size;
+    int columns_defined; /* TRUE after the columns are defined */
+    ScmObj params;    /* vector of column metadata, or #f until described */
+    ub2 stmt_type;    /* 0 until it is got */
+    ub4 fetch_size;   /* number of rows requested by the next execute */
+    ub4 define_rows;  /* number of rows each column handle holds */
+    ub4 rows_fetched; /* number of rows in the column handles */
+    ub4 cur_row;      /* current row in the column handles */
+    ub4 position;     /* position of the current row in the result set, 0 before the first */
+    int eof;          /* TRUE after OCIStmtFetch2 returns OCI_NO_DATA */
+    int row_ready;    /* TRUE when a nonblocking fetch has made the next row current */
+    int scrollable;   /* TRUE to execute queries with OCI_STMT_SCROLLABLE_READONLY */
+    double started;   /* now() when the nonblocking call in progress was started */
+    oracle_stats_t stats; /* since the statement is prepared */
+    oracle_stats_t last;  /* since Scm_oracle_stmt_reset_last_stats */
+};
+
+/* an integer or real value set to a direct path column array */
+typedef union {
+    ScmInt64 i;
+    double d;
+} dirpath_value_t;
+
+struct Scm_OCIDirPath {
+    SCM_HEADER;
+    OCIDirPathCtx *dpctx; /* NULL after the load is finished or aborted */
+    OCIDirPathColArray *dpca;
+    OCIDirPathStream *dpstr;
+    Scm_OCISvcCtx *svc; /* the connection which loads the table */
+    ub2 column_count;
+    int *types;         /* enum dbd_oracle_bind_type of each column */
+    ub4 max_rows;       /* number of rows of the column array */
+    dirpath_value_t *values; /* max_rows values of each column */
+    ub4 row_count;      /* number of rows loaded */
+};
+
+struct Scm_OCILob {
+    SCM_HEADER;
+    OCILobLocator *locp;
+    Scm_OCISvcCtx *svc; /* the connection which the LOB belongs to */
+    Scm_OCIError *err;  /* its own, as a LOB is read outside the connection's lock.
+                         * made by check_lob when the LOB is first used. */
+    int type;  /* BIND_CLOB or BIND_BLOB */
+    ub1 csfrm; /* SQLCS_IMPLICIT, or SQLCS_NCHAR for NCLOB */
 };
 
 struct Scm_OCIParamMetadata {
@@ -35,21 +114,49 @@ struct Scm_OCIParamMetadata {
     ScmObj name;
     ub2 data_type;
     ub2 data_size;
+    ub2 char_size;   /* length in characters */
+    ub1 char_used;   /* TRUE for character length semantics */
+    ub4 define_size; /* buffer size to fetch the column as a string */
     sb2 precision;
     sb1 scale;
 };
 
-static OCIEnv *envhp;
-static Scm_OCIError *Scm_make_oracle_env(void);
+struct Scm_OCIStats {
+    SCM_HEADER;
+    oracle_stats_t stats;
+};
+
+/* adds val to a counter of the statement and its connection. */
+#define STATS_ADD(stmt, field, val) do { \
+    (stmt)->stats.field += (val); \
+    (stmt)->last.field += (val); \
+    (stmt)->svc->stats.field += (val); \
+} while (0)
+
+OCIEnv *envhp;
+static void stmt_free(Scm_OCIStmt *stmt);
+static void release_stmt(Scm_OCIStmt *stmt, ub4 mode);
+static ScmObj fetched(Scm_OCIError *err, Scm_OCIStmt *stmt, sword rv);
 static bind_handle_t *get_bind_handle(Scm_OCIStmt *stmt, u_int pos);
+static void check_bind_row(bind_handle_t *hndl, u_int pos, u_int row);
 static bind_handle_t *get_column_handle(Scm_OCIStmt *stmt, u_int pos);
+static sword define_column(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, void *valuep, sb4 value_sz);
+static sword get_stmt_type(Scm_OCIError *err, Scm_OCIStmt *stmt, ub2 *stmt_type);
 static ScmObj get_ub2_attr(Scm_OCIError *err, void *hndl, ub4 hndl_type, ub4 attr_type);
 static ScmObj get_ub4_attr(Scm_OCIError *err, void *hndl, ub4 hndl_type, ub4 attr_type);
+static ScmObj set_ub4_attr(Scm_OCIError *err, void *hndl, ub4 hndl_type, ub4 attr_type, ub4 val);
+static double now(void);
+static sb4 get_charset_maxbytes(Scm_OCIError *err);
+static ScmObj make_stats(const oracle_stats_t *stats);
 
 SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_OCIErrorClass, NULL);
 SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_OCISvcCtxClass, NULL);
 SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_OCIStmtClass, NULL);
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_OCISPoolClass, NULL);
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_OCIDirPathClass, NULL);
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_OCILobClass, NULL);
 SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_OCIParamMetadataClass, NULL);
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_OCIStatsClass, NULL);
 
 static void error_finalize(ScmObj obj, void *data)
 {
@@ -66,52 +173,99 @@ static void svcctx_finalize(ScmObj obj, void *data)
     Scm_OCISvcCtx *svc = (Scm_OCISvcCtx *)obj;
 
     if (svc->svchp != NULL) {
-        OCIHandleFree(svc->svchp, OCI_HTYPE_SVCCTX);
+        if (svc->pool != NULL) {
+            /* return the session to the pool if it is still open. */
+            OCIError *errhp;
+
+            if (svc->pool->spoolhp != NULL
+                && OCIHandleAlloc(envhp, (dvoid**)&errhp, OCI_HTYPE_ERROR, 0, NULL) == OCI_SUCCESS) {
+                OCISessionRelease(svc->svchp, errhp, NULL, 0, OCI_DEFAULT);
+                OCIHandleFree(errhp, OCI_HTYPE_ERROR);
+            }
+        } else {
+            OCIHandleFree(svc->svchp, OCI_HTYPE_SVCCTX);
+        }
         svc->svchp = NULL;
     }
 }
 
+static void spool_finalize(ScmObj obj, void *data)
+{
+    Scm_OCISPool *pool = (Scm_OCISPool *)obj;
+
+    if (pool->spoolhp != NULL) {
+        OCIError *errhp;
+
+        if (OCIHandleAlloc(envhp, (dvoid**)&errhp, OCI_HTYPE_ERROR, 0, NULL) == OCI_SUCCESS) {
+            OCISessionPoolDestroy(pool->spoolhp, errhp, OCI_SPD_FORCE);
+            OCIHandleFree(errhp, OCI_HTYPE_ERROR);
+        }
+        OCIHandleFree(pool->spoolhp, OCI_HTYPE_SPOOL);
+        pool->spoolhp = NULL;
+    }
+}
+
+/*
+ * Finalizers run in whichever thread the GC happens, possibly while
+ * another thread uses the error handle of the connection. Calls made
+ * while a statement is finalized use a private error handle instead.
+ */
 static void stmt_finalize(ScmObj obj, void *data)
 {
     Scm_OCIStmt *stmt = (Scm_OCIStmt *)obj;
 
+    stmt->err = NULL;
+    stmt_free(stmt);
+}
+
+static void stmt_free(Scm_OCIStmt *stmt)
+{
     if (stmt->bind_handles != NULL) {
         sb4 idx;
 
         for (idx = 0; idx < stmt->bind_count; idx++) {
-            bind_handle_t *hndl = &stmt->bind_handles[idx];
-            if (hndl->vptr != NULL) {
-                hndl->vptr->clear(hndl);
-            }
+            bind_handle_clear(&stmt->bind_handles[idx]);
         }
         free(stmt->bind_handles);
+        stmt->bind_handles = NULL;
+        stmt->bind_count = 0;
     }
     if (stmt->column_handles != NULL) {
         sb4 idx;
 
         for (idx = 0; idx < stmt->column_count; idx++) {
-            bind_handle_t *hndl = &stmt->column_handles[idx];
-            if (hndl->vptr != NULL) {
-                hndl->vptr->clear(hndl);
-            }
+            bind_handle_clear(&stmt->column_handles[idx]);
         }
         free(stmt->column_handles);
+        stmt->column_handles = NULL;
+        stmt->column_count = 0;
     }
+    free(stmt->column_arena);
+    stmt->column_arena = NULL;
+    stmt->column_arena_size = 0;
+    stmt->columns_defined = FALSE;
     if (stmt->stmtp != NULL) {
-        OCIHandleFree(stmt->stmtp, OCI_HTYPE_STMT);
+        /* stmtp was freed by OCILogoff if the connection is closed. */
+        if (stmt->svc->svchp != NULL) {
+            release_stmt(stmt, OCI_DEFAULT);
+        }
         stmt->stmtp = NULL;
     }
 }
 
-static Scm_OCIError *Scm_make_oracle_env(void)
+/*
+ * Returns stmtp to the statement cache of the connection.
+ */
+static void release_stmt(Scm_OCIStmt *stmt, ub4 mode)
 {
-    Scm_OCIError *err = SCM_NEW(Scm_OCIError);
-    sword rv;
-    err->type = OCI_HTYPE_ENV;
-    err->errhp = envhp;
+    OCIError *errhp = stmt->err != NULL ? stmt->err->errhp : NULL;
 
-    SCM_SET_CLASS(err, SCM_CLASS_OCIERROR);
-    return err;
+    if (errhp != NULL) {
+        OCIStmtRelease(stmt->stmtp, errhp, NULL, 0, mode);
+    } else if (OCIHandleAlloc(envhp, (dvoid**)&errhp, OCI_HTYPE_ERROR, 0, NULL) == OCI_SUCCESS) {
+        OCIStmtRelease(stmt->stmtp, errhp, NULL, 0, mode);
+        OCIHandleFree(errhp, OCI_HTYPE_ERROR);
+    }
 }
 
 static bind_handle_t *get_bind_handle(Scm_OCIStmt *stmt, u_int pos)
@@ -122,6 +276,16 @@ static bind_handle_t *get_bind_handle(Scm_OCIStmt *stmt, u_int pos)
     return &stmt->bind_handles[pos];
 }
 
+static void check_bind_row(bind_handle_t *hndl, u_int pos, u_int row)
+{
+    if (hndl->vptr == NULL) {
+        Scm_Error("bind position %d is not initialized", pos);
+    }
+    if (hndl->max_rows <= row) {
+        Scm_Error("invalid row %d for 0 - %d", row, hndl->max_rows);
+    }
+}
+
 static bind_handle_t *get_column_handle(Scm_OCIStmt *stmt, u_int pos)
 {
     if (stmt->column_count <= pos) {
@@ -137,9 +301,9 @@ static ScmObj get_ub2_attr(Scm_OCIError *err, void *hndl, ub4 hndl_type, ub4 att
 
     rv = OCIAttrGet(hndl, hndl_type, &val, NULL, attr_type, err->errhp);
     if (rv != OCI_SUCCESS) {
-        return ERROR(rv, err);
+        RAISE_ERROR(rv, err);
     }
-    return SUCCESS(SCM_MAKE_INT(val));
+    return SCM_MAKE_INT(val);
 }
 
 static ScmObj get_ub4_attr(Scm_OCIError *err, void *hndl, ub4 hndl_type, ub4 attr_type)
@@ -149,9 +313,28 @@ static ScmObj get_ub4_attr(Scm_OCIError *err, void *hndl, ub4 hndl_type, ub4 att
 
     rv = OCIAttrGet(hndl, hndl_type, &val, NULL, attr_type, err->errhp);
     if (rv != OCI_SUCCESS) {
-        return ERROR(rv, err);
+        RAISE_ERROR(rv, err);
+    }
+    return Scm_MakeIntegerU(val);
+}
+
+static ScmObj set_ub4_attr(Scm_OCIError *err, void *hndl, ub4 hndl_type, ub4 attr_type, ub4 val)
+{
+    sword rv;
+
+    rv = OCIAttrSet(hndl, hndl_type, &val, sizeof(val), attr_type, err->errhp);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
     }
-    return SUCCESS(Scm_MakeIntegerU(val));
+    return SCM_NIL;
+}
+
+static double now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
 }
 
 
@@ -166,9 +349,9 @@ ScmObj Scm_make_oracle_error(void)
     err->type = OCI_HTYPE_ERROR;
     rv = OCIHandleAlloc(envhp, (dvoid**)&err->errhp, OCI_HTYPE_ERROR, 0, NULL);
     if (rv != OCI_SUCCESS) {
-        return ALLOC_ERROR(rv);
+        RAISE_ALLOC_ERROR(rv);
     }
-    return SUCCESS(err);
+    return SCM_OBJ(err);
 }
 
 void Scm_oracle_error_close(Scm_OCIError *err)
@@ -176,8 +359,14 @@ void Scm_oracle_error_close(Scm_OCIError *err)
     error_finalize(SCM_OBJ(err), NULL);
 }
 
-ScmObj Scm_error_to_message(int status, Scm_OCIError *err)
+/*
+ * Raises <dbd-oracle-error> for the status of an OCI call. errhp is
+ * an error handle or the environment handle as specified by htype.
+ * The condition is made by %raise-oracle-error in dbd.oracle.
+ */
+void Scm_oracle_raise_error(sword status, void *errhp, ub4 htype)
 {
+    static ScmObj raise_proc = SCM_UNDEFINED;
     char buf[512];
     sb4 errcode = - status;
     ScmObj msg;
@@ -188,7 +377,8 @@ ScmObj Scm_error_to_message(int status, Scm_OCIError *err)
         break;
     case OCI_SUCCESS_WITH_INFO:
     case OCI_ERROR:
-        OCIErrorGet(err->errhp, 1, NULL, &errcode, buf, sizeof(buf), err->type);
+        buf[0] = '\0';
+        OCIErrorGet(errhp, 1, NULL, &errcode, (OraText*)buf, sizeof(buf), htype);
         msg = SCM_MAKE_STR_COPYING(buf);
         break;
     case OCI_NEED_DATA:
@@ -210,7 +400,8 @@ ScmObj Scm_error_to_message(int status, Scm_OCIError *err)
         msg = Scm_Sprintf("Unknown error status: %d", status);
         break;
     }
-    return Scm_Cons(SCM_MAKE_INT(errcode), msg);
+    SCM_BIND_PROC(raise_proc, "%raise-oracle-error", SCM_MODULE(SCM_FIND_MODULE("dbd.oracle", 0)));
+    Scm_ApplyRec(raise_proc, SCM_LIST2(SCM_MAKE_INT(errcode), msg));
 }
 
 ScmObj Scm_oracle_connect(Scm_OCIError *err, const char *user, const char *passwd, const char *dbname)
@@ -219,30 +410,262 @@ ScmObj Scm_oracle_connect(Scm_OCIError *err, const char *user, const char *passw
     sword rv;
 
     svc->svchp = NULL;
+    svc->pool = NULL;
+    svc->get_time = 0;
+    svc->autocommit = TRUE;
+    memset(&svc->stats, 0, sizeof(svc->stats));
     SCM_SET_CLASS(svc, SCM_CLASS_OCISVCCTX);
     Scm_RegisterFinalizer(SCM_OBJ(svc), svcctx_finalize, NULL);
 
-    rv = OCILogon(envhp, err->errhp, &svc->svchp, user, strlen(user), passwd, strlen(passwd),
-                  dbname, strlen(dbname));
+    rv = OCILogon2(envhp, err->errhp, &svc->svchp, user, strlen(user), passwd, strlen(passwd),
+                   dbname, strlen(dbname), OCI_LOGON2_STMTCACHE);
     if (rv != OCI_SUCCESS) {
-        return ERROR(rv, err);
+        RAISE_ERROR(rv, err);
     }
-    return SUCCESS(svc);
+    return SCM_OBJ(svc);
 }
 
 ScmObj Scm_oracle_disconnect(Scm_OCIError *err, Scm_OCISvcCtx *svc)
 {
     sword rv;
 
+    if (svc->pool != NULL) {
+        if (svc->pool->spoolhp == NULL) {
+            /* the session was closed with the pool. */
+            svc->svchp = NULL;
+            return SCM_UNDEFINED;
+        }
+        rv = OCISessionRelease(svc->svchp, err->errhp, NULL, 0, OCI_DEFAULT);
+        svc->svchp = NULL;
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        return SCM_UNDEFINED;
+    }
     rv = OCILogoff(svc->svchp, err->errhp);
     svcctx_finalize(SCM_OBJ(svc), NULL);
     if (rv != OCI_SUCCESS) {
-        return ERROR(rv, err);
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_UNDEFINED;
+}
+
+ScmObj Scm_oracle_set_autocommit(Scm_OCIError *err, Scm_OCISvcCtx *svc, int autocommit)
+{
+    svc->autocommit = autocommit;
+    return SCM_NIL;
+}
+
+ScmObj Scm_oracle_autocommit_p(Scm_OCIError *err, Scm_OCISvcCtx *svc)
+{
+    return SCM_MAKE_BOOL(svc->autocommit);
+}
+
+/*
+ * Puts the server handle of the connection into nonblocking mode, in
+ * which a call which has to wait for the server returns
+ * OCI_STILL_EXECUTING and is called again until it completes, or back
+ * into blocking mode.
+ */
+ScmObj Scm_oracle_set_nonblocking(Scm_OCIError *err, Scm_OCISvcCtx *svc, int nonblocking)
+{
+    OCIServer *srvhp;
+    ub1 current = FALSE;
+    sword rv;
+
+    rv = OCIAttrGet(svc->svchp, OCI_HTYPE_SVCCTX, &srvhp, NULL, OCI_ATTR_SERVER, err->errhp);
+    if (rv == OCI_SUCCESS) {
+        rv = OCIAttrGet(srvhp, OCI_HTYPE_SERVER, &current, NULL, OCI_ATTR_NONBLOCKING_MODE, err->errhp);
+    }
+    if (rv == OCI_SUCCESS && !current != !nonblocking) {
+        /* setting the attribute toggles the mode. */
+        rv = OCIAttrSet(srvhp, OCI_HTYPE_SERVER, NULL, 0, OCI_ATTR_NONBLOCKING_MODE, err->errhp);
+    }
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_NIL;
+}
+
+ScmObj Scm_oracle_nonblocking_p(Scm_OCIError *err, Scm_OCISvcCtx *svc)
+{
+    OCIServer *srvhp;
+    ub1 current = FALSE;
+    sword rv;
+
+    rv = OCIAttrGet(svc->svchp, OCI_HTYPE_SVCCTX, &srvhp, NULL, OCI_ATTR_SERVER, err->errhp);
+    if (rv == OCI_SUCCESS) {
+        rv = OCIAttrGet(srvhp, OCI_HTYPE_SERVER, &current, NULL, OCI_ATTR_NONBLOCKING_MODE, err->errhp);
+    }
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_MAKE_BOOL(current);
+}
+
+ScmObj Scm_oracle_commit(Scm_OCIError *err, Scm_OCISvcCtx *svc)
+{
+    sword rv;
+
+    rv = OCITransCommit(svc->svchp, err->errhp, OCI_DEFAULT);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_NIL;
+}
+
+ScmObj Scm_oracle_rollback(Scm_OCIError *err, Scm_OCISvcCtx *svc)
+{
+    sword rv;
+
+    rv = OCITransRollback(svc->svchp, err->errhp, OCI_DEFAULT);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_NIL;
+}
+
+ScmObj Scm_oracle_pool_create(Scm_OCIError *err, const char *user, const char *passwd, const char *dbname,
+                              u_int min, u_int max, u_int incr, u_int timeout)
+{
+    Scm_OCISPool *pool = SCM_NEW(Scm_OCISPool);
+    sword rv;
+
+    pool->spoolhp = NULL;
+    pool->name = NULL;
+    pool->name_len = 0;
+    pool->get_count = 0;
+    pool->wait_time = 0.0;
+    SCM_SET_CLASS(pool, SCM_CLASS_OCISPOOL);
+    Scm_RegisterFinalizer(SCM_OBJ(pool), spool_finalize, NULL);
+
+    rv = OCIHandleAlloc(envhp, (dvoid**)&pool->spoolhp, OCI_HTYPE_SPOOL, 0, NULL);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ALLOC_ERROR(rv);
+    }
+    rv = OCISessionPoolCreate(envhp, err->errhp, pool->spoolhp, &pool->name, &pool->name_len,
+                              dbname, strlen(dbname), min, max, incr,
+                              (OraText*)user, strlen(user), (OraText*)passwd, strlen(passwd),
+                              OCI_SPC_HOMOGENEOUS | OCI_SPC_STMTCACHE);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    if (timeout > 0) {
+        rv = OCIAttrSet(pool->spoolhp, OCI_HTYPE_SPOOL, &timeout, sizeof(timeout),
+                        OCI_ATTR_SPOOL_TIMEOUT, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+    }
+    return SCM_OBJ(pool);
+}
+
+ScmObj Scm_oracle_pool_close(Scm_OCIError *err, Scm_OCISPool *pool)
+{
+    sword rv;
+
+    if (pool->spoolhp == NULL) {
+        return SCM_UNDEFINED;
+    }
+    rv = OCISessionPoolDestroy(pool->spoolhp, err->errhp, OCI_DEFAULT);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    OCIHandleFree(pool->spoolhp, OCI_HTYPE_SPOOL);
+    pool->spoolhp = NULL;
+    return SCM_UNDEFINED;
+}
+
+/*
+ * Gets a session from the pool. It is returned to the pool by
+ * Scm_oracle_disconnect. The time spent is added to the statistics of
+ * the pool by Scm_oracle_pool_count_get, which the caller calls holding
+ * the lock of the pool; the pool must not be closed meanwhile.
+ */
+ScmObj Scm_oracle_pool_connect(Scm_OCIError *err, Scm_OCISPool *pool)
+{
+    Scm_OCISvcCtx *svc = SCM_NEW(Scm_OCISvcCtx);
+    double start;
+    sword rv;
+
+    if (pool->spoolhp == NULL) {
+        Scm_Error("session pool is already closed");
+    }
+    svc->svchp = NULL;
+    svc->pool = pool;
+    svc->autocommit = TRUE;
+    svc->get_time = 0;
+    memset(&svc->stats, 0, sizeof(svc->stats));
+    SCM_SET_CLASS(svc, SCM_CLASS_OCISVCCTX);
+    Scm_RegisterFinalizer(SCM_OBJ(svc), svcctx_finalize, NULL);
+
+    start = now();
+    rv = OCISessionGet(envhp, err->errhp, &svc->svchp, NULL, pool->name, pool->name_len,
+                       NULL, 0, NULL, NULL, NULL, OCI_SESSGET_SPOOL);
+    svc->get_time = now() - start;
+    if (rv != OCI_SUCCESS) {
+        svc->svchp = NULL;
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_OBJ(svc);
+}
+
+/*
+ * Counts the session svc got from the pool by Scm_oracle_pool_connect.
+ */
+ScmObj Scm_oracle_pool_count_get(Scm_OCIError *err, Scm_OCISPool *pool, Scm_OCISvcCtx *svc)
+{
+    pool->wait_time += svc->get_time;
+    pool->get_count++;
+    return SCM_UNDEFINED;
+}
+
+/*
+ * Returns (open-count busy-count get-count wait-time).
+ */
+ScmObj Scm_oracle_pool_stats(Scm_OCIError *err, Scm_OCISPool *pool)
+{
+    ub4 open_count = 0;
+    ub4 busy_count = 0;
+    sword rv;
+
+    if (pool->spoolhp != NULL) {
+        rv = OCIAttrGet(pool->spoolhp, OCI_HTYPE_SPOOL, &open_count, NULL, OCI_ATTR_SPOOL_OPEN_COUNT, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        rv = OCIAttrGet(pool->spoolhp, OCI_HTYPE_SPOOL, &busy_count, NULL, OCI_ATTR_SPOOL_BUSY_COUNT, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
     }
-    return SUCCESS(SCM_UNDEFINED);
+    return Scm_List(Scm_MakeIntegerU(open_count), Scm_MakeIntegerU(busy_count),
+                    Scm_MakeIntegerU(pool->get_count), Scm_MakeFlonum(pool->wait_time),
+                    NULL);
+}
+
+ScmObj Scm_oracle_svcctx_stats(Scm_OCIError *err, Scm_OCISvcCtx *svc)
+{
+    return make_stats(&svc->stats);
+}
+
+ScmObj Scm_oracle_svcctx_reset_stats(Scm_OCIError *err, Scm_OCISvcCtx *svc)
+{
+    memset(&svc->stats, 0, sizeof(svc->stats));
+    return SCM_UNDEFINED;
+}
+
+ScmObj Scm_oracle_set_stmt_cache_size(Scm_OCIError *err, Scm_OCISvcCtx *svc, u_int size)
+{
+    return set_ub4_attr(err, svc->svchp, OCI_HTYPE_SVCCTX, OCI_ATTR_STMTCACHESIZE, size);
 }
 
-ScmObj Scm_oracle_stmt_prepare(Scm_OCIError *err, const char *sql)
+/*
+ * Prepares sql through the statement cache of the connection.
+ * If bind_count is negative, the number of bind variables is
+ * retrieved from the statement.
+ */
+ScmObj Scm_oracle_stmt_prepare(Scm_OCIError *err, Scm_OCISvcCtx *svc, const char *sql, int bind_count)
 {
     Scm_OCIStmt *stmt = SCM_NEW(Scm_OCIStmt);
     sb4 found;
@@ -252,24 +675,53 @@ ScmObj Scm_oracle_stmt_prepare(Scm_OCIError *err, const char *sql)
     ub1 inpl[1];
     ub1 dupl[1];
     OCIBind *hndl[1];
+    double start;
     sword rv;
 
     stmt->stmtp = NULL;
+    stmt->svc = svc;
+    stmt->err = err;
     stmt->bind_count = 0;
+    stmt->bind_names = SCM_FALSE;
     stmt->column_count = 0;
     stmt->bind_handles = NULL;
     stmt->column_handles = NULL;
+    stmt->column_arena = NULL;
+    stmt->column_arena_size = 0;
+    stmt->columns_defined = FALSE;
+    stmt->params = SCM_FALSE;
+    stmt->stmt_type = 0;
+    stmt->fetch_size = DEFAULT_FETCH_SIZE;
+    stmt->define_rows = 0;
+    stmt->rows_fetched = 0;
+    stmt->cur_row = 0;
+    stmt->position = 0;
+    stmt->eof = FALSE;
+    stmt->row_ready = FALSE;
+    stmt->scrollable = FALSE;
+    stmt->started = 0.0;
+    memset(&stmt->stats, 0, sizeof(stmt->stats));
+    memset(&stmt->last, 0, sizeof(stmt->last));
 
     SCM_SET_CLASS(stmt, SCM_CLASS_OCISTMT);
     Scm_RegisterFinalizer(SCM_OBJ(stmt), stmt_finalize, NULL);
 
-    rv = OCIHandleAlloc(envhp, (dvoid **)&stmt->stmtp, OCI_HTYPE_STMT, 0, NULL);
+    start = now();
+    rv = OCIStmtPrepare2(svc->svchp, &stmt->stmtp, err->errhp, sql, strlen(sql), NULL, 0,
+                         OCI_NTV_SYNTAX, OCI_DEFAULT);
+    STATS_ADD(stmt, prepare_time, now() - start);
     if (rv != OCI_SUCCESS) {
-        return ALLOC_ERROR(rv);
+        if (stmt->stmtp != NULL) {
+            /* don't keep a statement which failed to be parsed. */
+            release_stmt(stmt, OCI_STRLS_CACHE_DELETE);
+            stmt->stmtp = NULL;
+        }
+        RAISE_ERROR(rv, err);
     }
-    rv = OCIStmtPrepare(stmt->stmtp, err->errhp, sql, strlen(sql), OCI_NTV_SYNTAX, OCI_DEFAULT);
-    if (rv != OCI_SUCCESS) {
-        return ERROR(rv, err);
+    if (bind_count >= 0) {
+        stmt->bind_count = bind_count;
+        stmt->bind_handles = calloc(bind_count, sizeof(bind_handle_t));
+        return SCM_OBJ(stmt);
     }
     rv = OCIStmtGetBindInfo(stmt->stmtp, err->errhp, 0, 1, &found, bvnp, bvnl, invp, inpl, dupl, hndl);
     if (rv == OCI_NO_DATA) {
@@ -279,195 +731,2267 @@ ScmObj Scm_oracle_stmt_prepare(Scm_OCIError *err, const char *sql)
         stmt->bind_count = abs(found);
         stmt->bind_handles = calloc(stmt->bind_count, sizeof(bind_handle_t));
     } else {
-        return ERROR(rv, err);
+        RAISE_ERROR(rv, err);
     }
-    return SUCCESS(stmt);
+    return SCM_OBJ(stmt);
 }
 
 void Scm_oracle_stmt_close(Scm_OCIStmt *stmt)
 {
-    stmt_finalize(SCM_OBJ(stmt), NULL);
+    stmt_free(stmt);
 }
 
-ScmObj Scm_oracle_stmt_bind_count(Scm_OCIError *err, Scm_OCIStmt *stmt)
+ScmObj Scm_oracle_stmt_set_fetch_size(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int size)
 {
-    return SUCCESS(SCM_MAKE_INT(stmt->bind_count));
+    if (size == 0) {
+        Scm_Error("fetch size must be positive");
+    }
+    stmt->fetch_size = size;
+    return SCM_NIL;
 }
 
-ScmObj Scm_oracle_stmt_bind_init(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size)
+ScmObj Scm_oracle_stmt_set_prefetch_rows(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int rows)
 {
-    bind_handle_t *hndl = get_bind_handle(stmt, pos);
-    sword rv;
+    return set_ub4_attr(err, stmt->stmtp, OCI_HTYPE_STMT, OCI_ATTR_PREFETCH_ROWS, rows);
+}
 
-    bind_handle_init(hndl, type, size);
-    rv = OCIBindByPos(stmt->stmtp, (dvoid*)&hndl->bindp, err->errhp,
-                      pos + 1, hndl->valuep, hndl->value_sz, hndl->vptr->dty, &hndl->ind, NULL, NULL,
-                      0, NULL, OCI_DEFAULT);
-    if (rv != OCI_SUCCESS) {
-        return ERROR(rv, err);
-    }
-    return SUCCESS(SCM_NIL);
+ScmObj Scm_oracle_stmt_set_prefetch_memory(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int size)
+{
+    return set_ub4_attr(err, stmt->stmtp, OCI_HTYPE_STMT, OCI_ATTR_PREFETCH_MEMORY, size);
 }
 
-ScmObj Scm_oracle_stmt_bind_set(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, ScmObj val)
+ScmObj Scm_oracle_stmt_set_scrollable(Scm_OCIError *err, Scm_OCIStmt *stmt, int scrollable)
 {
-    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+    stmt->scrollable = scrollable;
+    return SCM_NIL;
+}
 
-    hndl->vptr->set(hndl, val);
-    return SUCCESS(SCM_NIL);
+ScmObj Scm_oracle_stmt_round_trips(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    return Scm_MakeIntegerU(stmt->stats.round_trips);
 }
 
-ScmObj Scm_oracle_stmt_bind_ref(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos)
+ScmObj Scm_oracle_stmt_stats(Scm_OCIError *err, Scm_OCIStmt *stmt)
 {
-    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+    return make_stats(&stmt->stats);
+}
 
-    return SUCCESS(hndl->vptr->get(hndl));
+/*
+ * Returns the counters since Scm_oracle_stmt_reset_last_stats, which
+ * is called at the start of each execution.
+ */
+ScmObj Scm_oracle_stmt_last_stats(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    return make_stats(&stmt->last);
 }
 
-ScmObj Scm_oracle_stmt_column_init(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size)
+ScmObj Scm_oracle_stmt_reset_stats(Scm_OCIError *err, Scm_OCIStmt *stmt)
 {
-    bind_handle_t *hndl = get_column_handle(stmt, pos);
-    sword rv;
+    memset(&stmt->stats, 0, sizeof(stmt->stats));
+    memset(&stmt->last, 0, sizeof(stmt->last));
+    return SCM_UNDEFINED;
+}
 
-    bind_handle_init(hndl, type, size);
-    rv = OCIDefineByPos(stmt->stmtp, (dvoid*)&hndl->bindp, err->errhp,
-                        pos + 1, hndl->valuep, hndl->value_sz, hndl->vptr->dty, &hndl->ind, NULL, NULL,
-                        OCI_DEFAULT);
-    if (rv != OCI_SUCCESS) {
-        return ERROR(rv, err);
+/*
+ * Starts counting a new execution. The prepare time is kept until
+ * the first execution so that it is counted in it.
+ */
+ScmObj Scm_oracle_stmt_reset_last_stats(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    memset(&stmt->last, 0, sizeof(stmt->last));
+    if (stmt->stats.executes == 0) {
+        stmt->last.prepare_time = stmt->stats.prepare_time;
     }
-    return SUCCESS(SCM_NIL);
+    return SCM_UNDEFINED;
 }
 
-ScmObj Scm_oracle_stmt_column_ref(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos)
+ScmObj Scm_oracle_stmt_bind_count(Scm_OCIError *err, Scm_OCIStmt *stmt)
 {
-    bind_handle_t *hndl = get_column_handle(stmt, pos);
-
-    return SUCCESS(hndl->vptr->get(hndl));
+    return SCM_MAKE_INT(stmt->bind_count);
 }
 
-ScmObj Scm_oracle_stmt_execute(Scm_OCIError *err, Scm_OCISvcCtx *svc, Scm_OCIStmt *stmt)
+/*
+ * In-bind callback of a RETURNING INTO bind, which has no input value.
+ */
+static sb4 returning_in_cb(dvoid *ictxp, OCIBind *bindp, ub4 iter, ub4 index,
+                           dvoid **bufpp, ub4 *alenp, ub1 *piecep, dvoid **indpp)
 {
-    sword rv;
-    ub2 stmt_type;
-    ub4 iters;
-    ub4 mode;
+    static sb2 null_ind = -1;
+    bind_handle_t *hndl = ictxp;
 
-    rv = OCIAttrGet(stmt->stmtp, OCI_HTYPE_STMT, &stmt_type, NULL, OCI_ATTR_STMT_TYPE, err->errhp);
-    if (rv != OCI_SUCCESS) {
-        return ERROR(rv, err);
+    if (iter == 0) {
+        hndl->rows_returned = 0;
+        hndl->rows_unallocated = 0;
     }
-    if (stmt_type == OCI_STMT_SELECT) {
-        iters = 0;
-        mode = OCI_DEFAULT;
-    } else {
-        iters = 1;
-        mode = OCI_COMMIT_ON_SUCCESS;
-    }
-    rv = OCIStmtExecute(svc->svchp, stmt->stmtp, err->errhp, iters, 0, NULL, NULL, mode);
-    if (rv != OCI_SUCCESS) {
-        return ERROR(rv, err);
+    *bufpp = NULL;
+    *alenp = 0;
+    *indpp = &null_ind;
+    *piecep = OCI_ONE_PIECE;
+    return OCI_CONTINUE;
+}
+
+/*
+ * Out-bind callback of a RETURNING INTO bind, called for each returned
+ * row. The buffers grow when the rows don't fit in them. This is called
+ * inside OCIStmtExecute, so it must not raise an error: a failed
+ * allocation is recorded in rows_unallocated and raised by
+ * check_returning after the execution. A statement with RETURNING INTO
+ * binds is executed with one iteration only. OCI asks for the buffer of
+ * the first row even if no rows are returned, so it is given one and
+ * rows_returned stays zero.
+ */
+static sb4 returning_out_cb(dvoid *octxp, OCIBind *bindp, ub4 iter, ub4 index,
+                            dvoid **bufpp, ub4 **alenpp, ub1 *piecep, dvoid **indpp, ub2 **rcodepp)
+{
+    bind_handle_t *hndl = octxp;
+
+    if (iter != 0) {
+        return OCI_ERROR;
     }
-    if (stmt_type == OCI_STMT_SELECT) {
-        ub4 param_count;
+    if (index == 0) {
+        ub4 rows;
+        sword rv = OCIAttrGet(bindp, OCI_HTYPE_BIND, &rows, NULL, OCI_ATTR_ROWS_RETURNED, hndl->errhp);
 
-        rv = OCIAttrGet(stmt->stmtp, OCI_HTYPE_STMT, &param_count, NULL, OCI_ATTR_PARAM_COUNT, err->errhp);
         if (rv != OCI_SUCCESS) {
-          return ERROR(rv, err);
+            return rv;
+        }
+        if (rows > hndl->max_rows) {
+            bind_handle_prepare(hndl, hndl->errhp, hndl->type, hndl->size, rows);
+            if (!bind_handle_try_alloc(hndl)) {
+                hndl->rows_unallocated = rows;
+                return OCI_ERROR;
+            }
+        }
+        if (hndl->alen == NULL) {
+            hndl->alen = calloc(hndl->max_rows, sizeof(ub4));
+            if (hndl->alen == NULL) {
+                return OCI_ERROR;
+            }
         }
-        stmt->column_count = param_count;
-        stmt->column_handles = calloc(param_count, sizeof(bind_handle_t));
+        hndl->rows_returned = rows;
     }
-    return SUCCESS(SCM_NIL);
+    if (index > 0 && index >= hndl->rows_returned) {
+        return OCI_ERROR;
+    }
+    hndl->alen[index] = hndl->value_sz;
+    *bufpp = BIND_HANDLE_VALUE(hndl, index);
+    *alenpp = &hndl->alen[index];
+    *indpp = &hndl->ind[index];
+    *rcodepp = NULL;
+    *piecep = OCI_ONE_PIECE;
+    return OCI_CONTINUE;
 }
 
-ScmObj Scm_oracle_stmt_fetch(Scm_OCIError *err, Scm_OCIStmt *stmt)
+/*
+ * Binds the position to a buffer of rows values. The current buffer
+ * and OCIBind handle are kept when they are large enough for the type
+ * and bound in the same mode. A RETURNING INTO bind gets its buffers
+ * through the callbacks above. A PL/SQL index-by table bind holds up
+ * to max_rows elements and OCI reads and writes the number of the
+ * elements in curelen.
+ */
+static sword bind_pos(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size, u_int rows,
+                      int mode)
 {
+    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+    int returning = (mode == BIND_MODE_RETURNING);
+    void *valuep;
+    sb2 *ind;
+    ub4 maxarr_len;
+    ub4 *curelep;
+    ub4 oci_mode;
     sword rv;
 
-    rv = OCIStmtFetch(stmt->stmtp, err->errhp, 1, OCI_FETCH_NEXT, OCI_DEFAULT);
-    if (rv == OCI_SUCCESS) {
-        return SUCCESS(SCM_TRUE);
-    } else if (rv == OCI_NO_DATA) {
-        return SUCCESS(SCM_FALSE);
+    if (hndl->mode == mode && bind_handle_reusable(hndl, type, &size, &rows)) {
+        return OCI_SUCCESS;
+    }
+    STATS_ADD(stmt, bind_reallocs, 1);
+    hndl->stmt = stmt;
+    bind_handle_init(hndl, err->errhp, type, size, rows);
+    hndl->mode = mode;
+    hndl->rows_returned = 0;
+    hndl->curelen = 0;
+    valuep = returning ? NULL : hndl->valuep;
+    ind = returning ? NULL : hndl->ind;
+    maxarr_len = (mode == BIND_MODE_TABLE) ? hndl->max_rows : 0;
+    curelep = (mode == BIND_MODE_TABLE) ? &hndl->curelen : NULL;
+    oci_mode = returning ? OCI_DATA_AT_EXEC : OCI_DEFAULT;
+    if (SCM_VECTORP(stmt->bind_names)) {
+        char name[130];
+        u_int namelen;
+        const char *str = Scm_GetStringContent(SCM_STRING(SCM_VECTOR_ELEMENTS(stmt->bind_names)[pos]),
+                                               &namelen, NULL, NULL);
+
+        if (namelen > sizeof(name) - 2) {
+            Scm_Error("too long placeholder name: %s", str);
+        }
+        name[0] = ':';
+        memcpy(name + 1, str, namelen);
+        rv = OCIBindByName(stmt->stmtp, (OCIBind**)&hndl->bindp, err->errhp,
+                           (OraText*)name, namelen + 1, valuep, hndl->value_sz,
+                           hndl->vptr->dty, ind, NULL, NULL, maxarr_len, curelep, oci_mode);
     } else {
-        return ERROR(rv, err);
+        rv = OCIBindByPos(stmt->stmtp, (dvoid*)&hndl->bindp, err->errhp,
+                          pos + 1, valuep, hndl->value_sz, hndl->vptr->dty, ind, NULL, NULL,
+                          maxarr_len, curelep, oci_mode);
     }
+    if (rv == OCI_SUCCESS && returning) {
+        rv = OCIBindDynamic(hndl->bindp, err->errhp, hndl, returning_in_cb, hndl, returning_out_cb);
+    }
+    return rv;
 }
 
-ScmObj Scm_oracle_stmt_type(Scm_OCIError *err, Scm_OCIStmt *stmt)
+/*
+ * Makes the statement bind its placeholders by name. The position of
+ * a bind is the index of its name in the vector names, which has the
+ * unique names of the statement; the count of OCIStmtGetBindInfo
+ * includes a name used at several places once for each.
+ */
+ScmObj Scm_oracle_stmt_set_bind_names(Scm_OCIError *err, Scm_OCIStmt *stmt, ScmObj names)
 {
-    return get_ub2_attr(err, stmt->stmtp, OCI_HTYPE_STMT, OCI_ATTR_STMT_TYPE);
+    sb4 count;
+    sb4 idx;
+
+    if (!SCM_VECTORP(names)) {
+        Scm_Error("vector of names required, but got %S", names);
+    }
+    count = SCM_VECTOR_SIZE(names);
+    if (count != stmt->bind_count) {
+        bind_handle_t *hndls = calloc(count, sizeof(bind_handle_t));
+
+        if (hndls == NULL && count > 0) {
+            Scm_Error("failed to allocate %d bind handles", count);
+        }
+        for (idx = 0; idx < stmt->bind_count; idx++) {
+            bind_handle_clear(&stmt->bind_handles[idx]);
+        }
+        free(stmt->bind_handles);
+        stmt->bind_handles = hndls;
+        stmt->bind_count = count;
+    }
+    stmt->bind_names = names;
+    return SCM_UNDEFINED;
 }
 
-ScmObj Scm_oracle_stmt_row_count(Scm_OCIError *err, Scm_OCIStmt *stmt)
+ScmObj Scm_oracle_stmt_bind_names(Scm_OCIError *err, Scm_OCIStmt *stmt)
 {
-    return get_ub4_attr(err, stmt->stmtp, OCI_HTYPE_STMT, OCI_ATTR_ROW_COUNT);
+    return stmt->bind_names;
 }
 
-ScmObj Scm_oracle_stmt_params(Scm_OCIError *err, Scm_OCIStmt *stmt)
+ScmObj Scm_oracle_stmt_bind_init(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size, u_int rows)
 {
-    ScmObj params = Scm_MakeVector(stmt->column_count, SCM_NIL);
-    ub4 pos;
-    sword rv;
+    sword rv = bind_pos(err, stmt, pos, type, size, rows, BIND_MODE_VALUE);
 
-    for (pos = 0; pos < stmt->column_count; pos++) {
-        Scm_OCIParamMetadata *param = SCM_NEW(Scm_OCIParamMetadata);
-        OCIParam *parmhp = NULL;
-        union {
-            char *_text;
-            ub2 _ub2;
-            sb2 _sb2;
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_NIL;
+}
+
+/*
+ * Binds a value for one execution. The bind type is chosen from the
+ * value. A null keeps the type of the last execution.
+ */
+static void bind_value(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, ScmObj val)
+{
+    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+    u_int size = 0;
+    int type;
+    sword rv;
+
+    if (SCM_NULLP(val)) {
+        type = hndl->vptr != NULL ? hndl->type : BIND_STRING;
+    } else if (SCM_INTEGERP(val)) {
+        type = BIND_INTEGER;
+    } else if (SCM_REALP(val)) {
+        type = BIND_REAL;
+    } else if (SCM_STRINGP(val)) {
+        type = BIND_STRING;
+        Scm_GetStringContent(SCM_STRING(val), &size, NULL, NULL);
+    } else if (SCM_ORACLE_LOB_P(val)) {
+        type = SCM_ORACLE_LOB(val)->type;
+    } else if ((type = bind_handle_date_type(val)) < 0) {
+        Scm_Error("can't bind %S", val);
+    }
+    rv = bind_pos(err, stmt, pos, type, size, 1, BIND_MODE_VALUE);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    hndl->vptr->set(hndl, 0, val);
+}
+
+/*
+ * Binds a list of values for one execution.
+ */
+ScmObj Scm_oracle_stmt_bind_params(Scm_OCIError *err, Scm_OCIStmt *stmt, ScmObj params)
+{
+    u_int pos = 0;
+    ScmObj lp;
+
+    SCM_FOR_EACH(lp, params) {
+        bind_value(err, stmt, pos, SCM_CAR(lp));
+        pos++;
+    }
+    return SCM_NIL;
+}
+
+ScmObj Scm_oracle_stmt_bind_param(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, ScmObj val)
+{
+    bind_value(err, stmt, pos, val);
+    return SCM_NIL;
+}
+
+/*
+ * Binds the position for output. val is the input value of an IN OUT
+ * bind and () for an OUT bind. The binds of INSERT, UPDATE, DELETE and
+ * MERGE statements are RETURNING INTO binds, which get a value for each
+ * processed row. The values are read by Scm_oracle_stmt_bind_ref after
+ * the execution.
+ */
+ScmObj Scm_oracle_stmt_bind_out(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size, ScmObj val)
+{
+    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+    ub2 stmt_type;
+    int returning;
+    sword rv;
+
+    rv = get_stmt_type(err, stmt, &stmt_type);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    returning = (stmt_type == OCI_STMT_INSERT || stmt_type == OCI_STMT_UPDATE
+                 || stmt_type == OCI_STMT_DELETE || stmt_type == OCI_STMT_MERGE);
+    rv = bind_pos(err, stmt, pos, type, size, 1,
+                  returning ? BIND_MODE_RETURNING : BIND_MODE_VALUE);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    if (returning) {
+        hndl->rows_returned = 0;
+    } else {
+        hndl->vptr->set(hndl, 0, val);
+    }
+    return SCM_NIL;
+}
+
+/*
+ * Binds the position as a PL/SQL index-by table of up to max elements
+ * and sets its elements from vals, a vector or a list. The elements of
+ * an s64vector and an f64vector are copied without conversion. The
+ * elements set by an OUT or IN OUT parameter are read by
+ * Scm_oracle_stmt_bind_ref after the execution.
+ */
+ScmObj Scm_oracle_stmt_bind_table(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size, u_int max, ScmObj vals)
+{
+    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+    ub4 n = 0;
+    ub4 i;
+    sword rv;
+
+    rv = bind_pos(err, stmt, pos, type, size, max, BIND_MODE_TABLE);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    if (SCM_VECTORP(vals)) {
+        n = SCM_VECTOR_SIZE(vals);
+        if (n > hndl->max_rows) {
+            Scm_Error("too many elements to bind: %u for %u", n, hndl->max_rows);
+        }
+        for (i = 0; i < n; i++) {
+            hndl->vptr->set(hndl, i, SCM_VECTOR_ELEMENTS(vals)[i]);
+        }
+    } else if (SCM_LISTP(vals)) {
+        ScmObj lp;
+
+        SCM_FOR_EACH(lp, vals) {
+            if (n >= hndl->max_rows) {
+                Scm_Error("too many elements to bind: more than %u", hndl->max_rows);
+            }
+            hndl->vptr->set(hndl, n++, SCM_CAR(lp));
+        }
+    } else if ((SCM_S64VECTORP(vals) && type == BIND_INTEGER)
+               || (SCM_F64VECTORP(vals) && type == BIND_REAL)) {
+        n = SCM_UVECTOR_SIZE(vals);
+        if (n > hndl->max_rows) {
+            Scm_Error("too many elements to bind: %u for %u", n, hndl->max_rows);
+        }
+        if (SCM_F64VECTORP(vals)) {
+            memcpy(hndl->valuep, SCM_F64VECTOR_ELEMENTS(vals), n * sizeof(double));
+        } else {
+            for (i = 0; i < n; i++) {
+                ((long*)hndl->valuep)[i] = (long)SCM_S64VECTOR_ELEMENTS(vals)[i];
+            }
+        }
+        memset(hndl->ind, 0, n * sizeof(sb2));
+    } else {
+        Scm_Error("vector or list required, but got %S", vals);
+    }
+    hndl->curelen = n;
+    return SCM_NIL;
+}
+
+/*
+ * Returns the length of buf without an incomplete UTF-8 character at
+ * its end.
+ */
+static size_t utf8_complete_length(const char *buf, size_t len)
+{
+    size_t i;
+
+    for (i = len; i > 0 && len - i < 4; i--) {
+        unsigned char c = buf[i - 1];
+
+        if ((c & 0xC0) != 0x80) {
+            /* c is the first byte of the last character. */
+            size_t n = (c < 0xC0) ? 1 : (c < 0xE0) ? 2 : (c < 0xF0) ? 3 : 4;
+
+            return (len - (i - 1) >= n) ? len : i - 1;
+        }
+    }
+    return len;
+}
+
+/*
+ * Writes the rest of port to the empty LOB locp by OCILobWrite2 in
+ * polling mode. The port is read one chunk at a time, so that the
+ * value is never in memory as a whole. A piece of a CLOB ends at
+ * a character boundary.
+ */
+static void write_lob(Scm_OCIError *err, Scm_OCIStmt *stmt, OCILobLocator *locp, int type, ScmPort *port)
+{
+    ub4 chunk_size = 0;
+    char *buf;
+    size_t carry = 0;
+    ub1 piece = OCI_FIRST_PIECE;
+    sword rv;
+
+    rv = OCILobGetChunkSize(stmt->svc->svchp, err->errhp, locp, &chunk_size);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    if (chunk_size == 0) {
+        chunk_size = LOB_DEFAULT_CHUNK_SIZE;
+    }
+    if (type == BIND_CLOB) {
+        chunk_size *= get_charset_maxbytes(err);
+    }
+    /* room for the bytes of an incomplete character carried over */
+    buf = SCM_NEW_ATOMIC2(char*, chunk_size + 4);
+    for (;;) {
+        int n = Scm_Getz(buf + carry, chunk_size, port);
+        size_t len = carry + (n > 0 ? n : 0);
+        int more = (Scm_Peekb(port) != EOF);
+        size_t send = (more && type == BIND_CLOB) ? utf8_complete_length(buf, len) : len;
+        oraub8 byte_amt = 0;
+        oraub8 char_amt = 0;
+
+        if (!more) {
+            piece = (piece == OCI_FIRST_PIECE) ? OCI_ONE_PIECE : OCI_LAST_PIECE;
+            if (len == 0) {
+                /* an empty port leaves the LOB empty. */
+                rv = OCI_SUCCESS;
+                break;
+            }
+        }
+        if (piece == OCI_ONE_PIECE) {
+            byte_amt = send;
+        }
+        rv = OCILobWrite2(stmt->svc->svchp, err->errhp, locp, &byte_amt, &char_amt, 1,
+                          buf, send, piece, NULL, NULL, 0, SQLCS_IMPLICIT);
+        if (!more || rv != OCI_NEED_DATA) {
+            break;
+        }
+        carry = len - send;
+        memmove(buf, buf + send, carry);
+        piece = OCI_NEXT_PIECE;
+    }
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+}
+
+/*
+ * Binds the position to a temporary LOB, which is filled with the rest
+ * of the input port for one execution. The temporary LOB of the last
+ * execution is freed.
+ */
+ScmObj Scm_oracle_stmt_bind_lob(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, ScmObj port)
+{
+    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+    OCILobLocator *locp;
+    sword rv;
+
+    if (type != BIND_CLOB && type != BIND_BLOB) {
+        Scm_Error("BIND_CLOB or BIND_BLOB required, but got %d", type);
+    }
+    if (!SCM_IPORTP(port)) {
+        Scm_Error("input port required, but got %S", port);
+    }
+    rv = bind_pos(err, stmt, pos, type, 0, 1, BIND_MODE_VALUE);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    locp = ((OCILobLocator**)hndl->valuep)[0];
+    Scm_oracle_lob_free_temporary(stmt, locp);
+    rv = OCILobCreateTemporary(stmt->svc->svchp, err->errhp, locp, OCI_DEFAULT, SQLCS_IMPLICIT,
+                               type == BIND_CLOB ? OCI_TEMP_CLOB : OCI_TEMP_BLOB,
+                               FALSE, OCI_DURATION_SESSION);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    hndl->ind[0] = 0;
+    write_lob(err, stmt, locp, type, SCM_PORT(port));
+    return SCM_NIL;
+}
+
+/*
+ * Returns the number of values of the bind at pos: the number of rows
+ * returned into a RETURNING INTO bind, the number of elements of a
+ * PL/SQL index-by table and the number of rows of the buffer otherwise.
+ */
+ScmObj Scm_oracle_stmt_bind_rows(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos)
+{
+    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+
+    if (hndl->vptr == NULL) {
+        Scm_Error("bind position %d is not initialized", pos);
+    }
+    switch (hndl->mode) {
+    case BIND_MODE_RETURNING:
+        return Scm_MakeIntegerU(hndl->rows_returned);
+    case BIND_MODE_TABLE:
+        return Scm_MakeIntegerU(hndl->curelen);
+    default:
+        return Scm_MakeIntegerU(hndl->max_rows);
+    }
+}
+
+ScmObj Scm_oracle_stmt_bind_set(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, u_int row, ScmObj val)
+{
+    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+
+    check_bind_row(hndl, pos, row);
+    hndl->vptr->set(hndl, row, val);
+    return SCM_NIL;
+}
+
+ScmObj Scm_oracle_stmt_bind_ref(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, u_int row)
+{
+    bind_handle_t *hndl = get_bind_handle(stmt, pos);
+
+    check_bind_row(hndl, pos, row);
+    return hndl->vptr->get(hndl, row);
+}
+
+/*
+ * Sets the type of the column at pos. The column is defined by
+ * Scm_oracle_stmt_define_columns after all columns are set.
+ */
+ScmObj Scm_oracle_stmt_column_init(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size)
+{
+    bind_handle_t *hndl = get_column_handle(stmt, pos);
+
+    hndl->stmt = stmt;
+    bind_handle_prepare(hndl, err->errhp, type, size, stmt->define_rows);
+    return SCM_NIL;
+}
+
+#define ARENA_ROUNDUP(sz) (((sz) + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1))
+
+/*
+ * Allocates the buffers of all columns and defines them.
+ *
+ * The value, indicator and length buffers are placed in one arena
+ * so that a fetched row is not scattered over the heap. Columns
+ * larger than ARENA_MAX_VALUE_SIZE, such as LONG, have their own
+ * buffers to keep the arena small.
+ */
+ScmObj Scm_oracle_stmt_define_columns(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    ub4 rows = stmt->define_rows ? stmt->define_rows : 1;
+    size_t values_sz = 0;
+    size_t ind_off, rlen_off, size;
+    ub4 arena_columns = 0;
+    char *arena;
+    u_int pos;
+    sword rv;
+
+    for (pos = 0; pos < stmt->column_count; pos++) {
+        bind_handle_t *hndl = &stmt->column_handles[pos];
+
+        if (hndl->vptr == NULL) {
+            Scm_Error("column %d is not initialized", pos);
+        }
+        if (hndl->value_sz <= ARENA_MAX_VALUE_SIZE) {
+            values_sz += ARENA_ROUNDUP((size_t)hndl->value_sz * rows);
+            arena_columns++;
+        }
+    }
+    ind_off = values_sz;
+    rlen_off = ind_off + ARENA_ROUNDUP(sizeof(sb2) * rows * arena_columns);
+    size = rlen_off + sizeof(ub2) * rows * arena_columns;
+
+    STATS_ADD(stmt, define_reallocs, 1);
+    free(stmt->column_arena);
+    stmt->column_arena = NULL;
+    stmt->column_arena_size = 0;
+    if (arena_columns > 0) {
+        if (posix_memalign(&stmt->column_arena, ARENA_ALIGN, size) != 0) {
+            stmt->column_arena = NULL;
+            Scm_Error("failed to allocate %lu bytes for columns", (u_long)size);
+        }
+        memset(stmt->column_arena, 0, size);
+        stmt->column_arena_size = size;
+    }
+
+    arena = stmt->column_arena;
+    values_sz = 0;
+    arena_columns = 0;
+    for (pos = 0; pos < stmt->column_count; pos++) {
+        bind_handle_t *hndl = &stmt->column_handles[pos];
+
+        if (hndl->value_sz <= ARENA_MAX_VALUE_SIZE) {
+            bind_handle_attach(hndl, arena + values_sz,
+                               (sb2*)(arena + ind_off) + (size_t)rows * arena_columns,
+                               (ub2*)(arena + rlen_off) + (size_t)rows * arena_columns);
+            values_sz += ARENA_ROUNDUP((size_t)hndl->value_sz * rows);
+            arena_columns++;
+        } else {
+            bind_handle_alloc(hndl);
+        }
+        rv = define_column(err, stmt, pos, hndl->valuep, hndl->value_sz);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+    }
+    stmt->columns_defined = TRUE;
+    return SCM_NIL;
+}
+
+ScmObj Scm_oracle_stmt_columns_defined_p(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    return SCM_MAKE_BOOL(stmt->columns_defined);
+}
+
+/*
+ * Defines the column at pos to be fetched into valuep, which is
+ * the value buffer of the column handle or the memory of a uniform
+ * vector. Indicators and lengths are always in the column handle.
+ */
+static sword define_column(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, void *valuep, sb4 value_sz)
+{
+    bind_handle_t *hndl = &stmt->column_handles[pos];
+
+    if (hndl->type == BIND_LONG) {
+        /* the buffers are given piece by piece by bind_handle_long_cb. */
+        sword rv = OCIDefineByPos(stmt->stmtp, (OCIDefine**)&hndl->bindp, err->errhp,
+                                  pos + 1, NULL, SB4MAXVAL, SQLT_LNG, NULL, NULL, NULL,
+                                  OCI_DYNAMIC_FETCH);
+
+        if (rv != OCI_SUCCESS) {
+            return rv;
+        }
+        return OCIDefineDynamic(hndl->bindp, err->errhp, hndl, bind_handle_long_cb);
+    }
+    return OCIDefineByPos(stmt->stmtp, (OCIDefine**)&hndl->bindp, err->errhp,
+                          pos + 1, valuep, value_sz, hndl->vptr->dty, hndl->ind, hndl->rlen, NULL,
+                          OCI_DEFAULT);
+}
+
+ScmObj Scm_oracle_stmt_column_ref(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos)
+{
+    bind_handle_t *hndl = get_column_handle(stmt, pos);
+
+    if (hndl->vptr == NULL) {
+        Scm_Error("column %d is not defined", pos);
+    }
+    if (stmt->cur_row >= stmt->rows_fetched) {
+        Scm_Error("no row has been fetched");
+    }
+    return hndl->vptr->get(hndl, stmt->cur_row);
+}
+
+/*
+ * Stores the current row to row if it is a vector of the column count.
+ * Otherwise a new vector is made.
+ */
+static ScmObj current_row(Scm_OCIStmt *stmt, ScmObj row)
+{
+    ub4 pos;
+
+    if (!SCM_VECTORP(row) || SCM_VECTOR_SIZE(row) != stmt->column_count) {
+        row = Scm_MakeVector(stmt->column_count, SCM_NIL);
+    }
+    for (pos = 0; pos < stmt->column_count; pos++) {
+        bind_handle_t *hndl = &stmt->column_handles[pos];
+
+        if (hndl->vptr == NULL) {
+            Scm_Error("column %d is not defined", pos);
+        }
+        SCM_VECTOR_ELEMENTS(row)[pos] = hndl->vptr->get(hndl, stmt->cur_row);
+    }
+    return row;
+}
+
+/*
+ * Fetches the next row into a vector. row is reused if it is a vector
+ * of the column count. Returns #f at the end.
+ */
+ScmObj Scm_oracle_stmt_fetch_row(Scm_OCIError *err, Scm_OCIStmt *stmt, ScmObj row)
+{
+    if (SCM_FALSEP(Scm_oracle_stmt_fetch(err, stmt))) {
+        return SCM_FALSE;
+    }
+    return current_row(stmt, row);
+}
+
+/*
+ * Fetches up to max rows, or the fetch size when max is 0, and returns
+ * them as a list of vectors. The list is empty at the end.
+ */
+ScmObj Scm_oracle_stmt_fetch_rows(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int max)
+{
+    ScmObj head = SCM_NIL, tail = SCM_NIL;
+    u_int n;
+
+    if (max == 0) {
+        max = stmt->define_rows;
+    }
+    for (n = 0; n < max; n++) {
+        if (SCM_FALSEP(Scm_oracle_stmt_fetch(err, stmt))) {
+            break;
+        }
+        SCM_APPEND1(head, tail, current_row(stmt, SCM_FALSE));
+    }
+    return head;
+}
+
+/*
+ * Fetches rows into the elements of the vector rows. Elements which are
+ * vectors of the column count are reused. Returns the number of rows
+ * fetched, which is less than the length of rows at the end.
+ */
+ScmObj Scm_oracle_stmt_fetch_rows_x(Scm_OCIError *err, Scm_OCIStmt *stmt, ScmObj rows)
+{
+    ScmObj *elems;
+    u_int n;
+
+    if (!SCM_VECTORP(rows)) {
+        Scm_Error("vector required, but got %S", rows);
+    }
+    elems = SCM_VECTOR_ELEMENTS(rows);
+    for (n = 0; n < SCM_VECTOR_SIZE(rows); n++) {
+        if (SCM_FALSEP(Scm_oracle_stmt_fetch(err, stmt))) {
+            break;
+        }
+        elems[n] = current_row(stmt, elems[n]);
+    }
+    return Scm_MakeIntegerU(n);
+}
+
+static sword get_stmt_type(Scm_OCIError *err, Scm_OCIStmt *stmt, ub2 *stmt_type)
+{
+    if (stmt->stmt_type == 0) {
+        sword rv = OCIAttrGet(stmt->stmtp, OCI_HTYPE_STMT, &stmt->stmt_type, NULL, OCI_ATTR_STMT_TYPE, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            return rv;
+        }
+    }
+    *stmt_type = stmt->stmt_type;
+    return OCI_SUCCESS;
+}
+
+/*
+ * Reallocates the defined columns for the current fetch_size.
+ */
+static ScmObj resize_columns(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    ub4 pos;
+
+    stmt->define_rows = stmt->fetch_size;
+    for (pos = 0; pos < stmt->column_count; pos++) {
+        bind_handle_t *hndl = &stmt->column_handles[pos];
+
+        bind_handle_prepare(hndl, err->errhp, hndl->type, hndl->size, stmt->define_rows);
+    }
+    return Scm_oracle_stmt_define_columns(err, stmt);
+}
+
+/*
+ * Raises the error of a RETURNING INTO bind whose buffers couldn't be
+ * allocated by returning_out_cb during the execution.
+ */
+static void check_returning(Scm_OCIStmt *stmt)
+{
+    ub4 idx;
+
+    for (idx = 0; idx < stmt->bind_count; idx++) {
+        bind_handle_t *hndl = &stmt->bind_handles[idx];
+
+        if (hndl->rows_unallocated > 0) {
+            ub4 rows = hndl->rows_unallocated;
+
+            hndl->rows_unallocated = 0;
+            Scm_Error("failed to allocate %u rows returned into bind position %u", rows, idx);
+        }
+    }
+}
+
+/*
+ * Gets the iteration count and the mode with which the statement is
+ * executed.
+ */
+static void execute_args(Scm_OCIError *err, Scm_OCISvcCtx *svc, Scm_OCIStmt *stmt,
+                         ub2 *stmt_type, ub4 *iters, ub4 *mode)
+{
+    sword rv;
+
+    rv = get_stmt_type(err, stmt, stmt_type);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    if (*stmt_type == OCI_STMT_SELECT) {
+        *iters = 0;
+        *mode = stmt->scrollable ? OCI_STMT_SCROLLABLE_READONLY : OCI_DEFAULT;
+    } else {
+        *iters = 1;
+        *mode = svc->autocommit ? OCI_COMMIT_ON_SUCCESS : OCI_DEFAULT;
+    }
+}
+
+/*
+ * Prepares the column handles of a query after it is executed.
+ */
+static void executed(Scm_OCIError *err, Scm_OCIStmt *stmt, ub2 stmt_type)
+{
+    sword rv;
+
+    if (stmt_type == OCI_STMT_SELECT) {
+        if (stmt->column_handles == NULL) {
+            ub4 param_count;
+
+            rv = OCIAttrGet(stmt->stmtp, OCI_HTYPE_STMT, &param_count, NULL, OCI_ATTR_PARAM_COUNT, err->errhp);
+            if (rv != OCI_SUCCESS) {
+                RAISE_ERROR(rv, err);
+            }
+            stmt->column_handles = calloc(param_count, sizeof(bind_handle_t));
+            if (stmt->column_handles == NULL) {
+                Scm_Error("failed to allocate %u column handles", param_count);
+            }
+            stmt->column_count = param_count;
+            stmt->define_rows = stmt->fetch_size;
+        } else if (stmt->columns_defined && stmt->define_rows != stmt->fetch_size) {
+            resize_columns(err, stmt);
+        }
+        stmt->rows_fetched = 0;
+        stmt->cur_row = 0;
+        stmt->position = 0;
+        stmt->eof = FALSE;
+        stmt->row_ready = FALSE;
+    }
+}
+
+/*
+ * Executes the statement. The columns of a query are described and
+ * defined at the first execution and kept for the later ones.
+ */
+ScmObj Scm_oracle_stmt_execute(Scm_OCIError *err, Scm_OCISvcCtx *svc, Scm_OCIStmt *stmt)
+{
+    sword rv;
+    ub2 stmt_type;
+    ub4 iters;
+    ub4 mode;
+    double start;
+
+    execute_args(err, svc, stmt, &stmt_type, &iters, &mode);
+    start = now();
+    rv = OCIStmtExecute(svc->svchp, stmt->stmtp, err->errhp, iters, 0, NULL, NULL, mode);
+    STATS_ADD(stmt, execute_time, now() - start);
+    STATS_ADD(stmt, executes, 1);
+    STATS_ADD(stmt, round_trips, 1);
+    check_returning(stmt);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    executed(err, stmt, stmt_type);
+    return SCM_NIL;
+}
+
+/*
+ * Starts executing the statement on a connection in nonblocking mode.
+ * Returns #t if the execution completed and #f if OCIStmtExecute
+ * returned OCI_STILL_EXECUTING, in which case the connection can't be
+ * used for anything else until Scm_oracle_stmt_execute_poll returns #t.
+ */
+ScmObj Scm_oracle_stmt_execute_start(Scm_OCIError *err, Scm_OCISvcCtx *svc, Scm_OCIStmt *stmt)
+{
+    stmt->started = now();
+    STATS_ADD(stmt, executes, 1);
+    STATS_ADD(stmt, round_trips, 1);
+    return Scm_oracle_stmt_execute_poll(err, svc, stmt);
+}
+
+/*
+ * Calls OCIStmtExecute again with the same arguments as the started
+ * one. Returns #t when it completed and #f while it is still executing.
+ * The execute time counts from the start to the completion.
+ */
+ScmObj Scm_oracle_stmt_execute_poll(Scm_OCIError *err, Scm_OCISvcCtx *svc, Scm_OCIStmt *stmt)
+{
+    sword rv;
+    ub2 stmt_type;
+    ub4 iters;
+    ub4 mode;
+
+    execute_args(err, svc, stmt, &stmt_type, &iters, &mode);
+    rv = OCIStmtExecute(svc->svchp, stmt->stmtp, err->errhp, iters, 0, NULL, NULL, mode);
+    if (rv == OCI_STILL_EXECUTING) {
+        return SCM_FALSE;
+    }
+    STATS_ADD(stmt, execute_time, now() - stmt->started);
+    check_returning(stmt);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    executed(err, stmt, stmt_type);
+    return SCM_TRUE;
+}
+
+/*
+ * Executes a DML statement once for each of the first iters rows of the
+ * bind handles in one round trip. Rows which failed don't stop the
+ * execution and are returned as a list of (row-index error-code . message).
+ */
+ScmObj Scm_oracle_stmt_execute_batch(Scm_OCIError *err, Scm_OCISvcCtx *svc, Scm_OCIStmt *stmt, u_int iters)
+{
+    OCIError *errhp2 = NULL;
+    ScmObj errors = SCM_NIL;
+    sword rv;
+    sword rv2;
+    ub4 idx;
+    ub4 num_errs = 0;
+    double start;
+
+    if (iters == 0) {
+        return SCM_NIL;
+    }
+    for (idx = 0; idx < stmt->bind_count; idx++) {
+        bind_handle_t *hndl = &stmt->bind_handles[idx];
+        if (hndl->mode == BIND_MODE_RETURNING && iters > 1) {
+            Scm_Error("RETURNING INTO bind position %d can't be executed in a batch", idx);
+        }
+        if (hndl->vptr == NULL || hndl->max_rows < iters) {
+            Scm_Error("bind position %d doesn't have %d rows", idx, iters);
+        }
+    }
+    start = now();
+    rv = OCIStmtExecute(svc->svchp, stmt->stmtp, err->errhp, iters, 0, NULL, NULL,
+                        OCI_BATCH_ERRORS | (svc->autocommit ? OCI_COMMIT_ON_SUCCESS : OCI_DEFAULT));
+    STATS_ADD(stmt, execute_time, now() - start);
+    STATS_ADD(stmt, executes, 1);
+    STATS_ADD(stmt, round_trips, 1);
+    if (rv != OCI_SUCCESS && rv != OCI_SUCCESS_WITH_INFO && rv != OCI_ERROR) {
+        RAISE_ERROR(rv, err);
+    }
+    rv2 = OCIAttrGet(stmt->stmtp, OCI_HTYPE_STMT, &num_errs, NULL, OCI_ATTR_NUM_DML_ERRORS, err->errhp);
+    if (rv2 != OCI_SUCCESS || num_errs == 0) {
+        /* failed as a whole, not per row. */
+        if (rv == OCI_ERROR) {
+            RAISE_ERROR(rv, err);
+        }
+        if (rv2 != OCI_SUCCESS) {
+            RAISE_ERROR(rv2, err);
+        }
+        return SCM_NIL;
+    }
+    rv = OCIHandleAlloc(envhp, (dvoid**)&errhp2, OCI_HTYPE_ERROR, 0, NULL);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ALLOC_ERROR(rv);
+    }
+    for (idx = 0; idx < num_errs; idx++) {
+        ub4 row_offset = 0;
+        sb4 errcode = 0;
+        char buf[512];
+
+        rv = OCIParamGet(err->errhp, OCI_HTYPE_ERROR, err->errhp, (dvoid**)&errhp2, idx);
+        if (rv != OCI_SUCCESS) {
+            break;
+        }
+        rv = OCIAttrGet(errhp2, OCI_HTYPE_ERROR, &row_offset, NULL, OCI_ATTR_DML_ROW_OFFSET, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            break;
+        }
+        buf[0] = '\0';
+        OCIErrorGet(errhp2, 1, NULL, &errcode, (OraText*)buf, sizeof(buf), OCI_HTYPE_ERROR);
+        errors = Scm_Cons(Scm_Cons(Scm_MakeIntegerU(row_offset),
+                                   Scm_Cons(SCM_MAKE_INT(errcode), SCM_MAKE_STR_COPYING(buf))),
+                          errors);
+    }
+    OCIHandleFree(errhp2, OCI_HTYPE_ERROR);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    return Scm_ReverseX(errors);
+}
+
+/*
+ * Empties the buffers of LONG columns before a fetch appends to them.
+ */
+static void reset_long_columns(Scm_OCIStmt *stmt)
+{
+    ub4 pos;
+
+    for (pos = 0; pos < stmt->column_count; pos++) {
+        bind_handle_t *hndl = &stmt->column_handles[pos];
+
+        if (hndl->vptr != NULL && hndl->type == BIND_LONG) {
+            bind_handle_long_reset(hndl);
+        }
+    }
+}
+
+/*
+ * Calls OCIStmtFetch2 and counts the call. offset is used only by
+ * OCI_FETCH_ABSOLUTE and OCI_FETCH_RELATIVE.
+ */
+static sword stmt_fetch(Scm_OCIError *err, Scm_OCIStmt *stmt, ub4 nrows, ub2 orientation, sb4 offset)
+{
+    double start;
+    sword rv;
+
+    reset_long_columns(stmt);
+    start = now();
+    rv = OCIStmtFetch2(stmt->stmtp, err->errhp, nrows, orientation, offset, OCI_DEFAULT);
+
+    STATS_ADD(stmt, fetch_time, now() - start);
+    STATS_ADD(stmt, fetches, 1);
+    STATS_ADD(stmt, round_trips, 1);
+    return rv;
+}
+
+/*
+ * Counts the rows in the column handles and the bytes of their
+ * non-null values.
+ */
+static void count_rows(Scm_OCIStmt *stmt, ub4 rows)
+{
+    u_long bytes = 0;
+    ub4 pos;
+    ub4 row;
+
+    for (pos = 0; pos < stmt->column_count; pos++) {
+        bind_handle_t *hndl = &stmt->column_handles[pos];
+
+        for (row = 0; row < rows; row++) {
+            if (hndl->ind[row] != -1) {
+                bytes += hndl->rlen[row];
+            }
+        }
+    }
+    STATS_ADD(stmt, rows, rows);
+    STATS_ADD(stmt, bytes, bytes);
+}
+
+/*
+ * Moves to the next row. Rows are fetched define_rows at a time into
+ * the column handles and handed out one by one from there.
+ */
+ScmObj Scm_oracle_stmt_fetch(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    if (stmt->stmtp == NULL) {
+        Scm_Error("statement is already closed");
+    }
+    if (stmt->row_ready) {
+        stmt->row_ready = FALSE;
+        return SCM_MAKE_BOOL(stmt->rows_fetched > 0);
+    }
+    if (stmt->cur_row + 1 < stmt->rows_fetched) {
+        stmt->cur_row++;
+        stmt->position++;
+        return SCM_TRUE;
+    }
+    if (stmt->eof) {
+        stmt->rows_fetched = 0;
+        stmt->cur_row = 0;
+        return SCM_FALSE;
+    }
+    return fetched(err, stmt, stmt_fetch(err, stmt, stmt->define_rows, OCI_FETCH_NEXT, 0));
+}
+
+/*
+ * Makes the first of the rows fetched by OCIStmtFetch2, which returned
+ * rv, current. Returns #f if no row was fetched.
+ */
+static ScmObj fetched(Scm_OCIError *err, Scm_OCIStmt *stmt, sword rv)
+{
+    ub4 rows;
+
+    if (rv == OCI_NO_DATA) {
+        stmt->eof = TRUE;
+    } else if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    rv = OCIAttrGet(stmt->stmtp, OCI_HTYPE_STMT, &rows, NULL, OCI_ATTR_ROWS_FETCHED, err->errhp);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    count_rows(stmt, rows);
+    stmt->rows_fetched = rows;
+    stmt->cur_row = 0;
+    if (rows > 0) {
+        stmt->position++;
+    }
+    return SCM_MAKE_BOOL(rows > 0);
+}
+
+/*
+ * Starts fetching the next batch of rows on a connection in nonblocking
+ * mode if the rows fetched are used up. Returns #t when the next row
+ * can be read without a round trip and #f if OCIStmtFetch2 returned
+ * OCI_STILL_EXECUTING, in which case Scm_oracle_stmt_fetch_poll is
+ * called until it returns #t. The next Scm_oracle_stmt_fetch then moves
+ * to the row fetched.
+ */
+ScmObj Scm_oracle_stmt_fetch_start(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    if (stmt->stmtp == NULL) {
+        Scm_Error("statement is already closed");
+    }
+    if (stmt->scrollable) {
+        Scm_Error("a scrollable statement can't be fetched in nonblocking mode");
+    }
+    if (stmt->row_ready || stmt->cur_row + 1 < stmt->rows_fetched || stmt->eof) {
+        return SCM_TRUE;
+    }
+    reset_long_columns(stmt);
+    stmt->started = now();
+    STATS_ADD(stmt, fetches, 1);
+    STATS_ADD(stmt, round_trips, 1);
+    return Scm_oracle_stmt_fetch_poll(err, stmt);
+}
+
+/*
+ * Calls OCIStmtFetch2 again with the same arguments as the started
+ * one. Returns #t when it completed and #f while it is still executing.
+ */
+ScmObj Scm_oracle_stmt_fetch_poll(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    sword rv;
+
+    rv = OCIStmtFetch2(stmt->stmtp, err->errhp, stmt->define_rows, OCI_FETCH_NEXT, 0, OCI_DEFAULT);
+    if (rv == OCI_STILL_EXECUTING) {
+        return SCM_FALSE;
+    }
+    STATS_ADD(stmt, fetch_time, now() - stmt->started);
+    fetched(err, stmt, rv);
+    stmt->row_ready = TRUE;
+    return SCM_TRUE;
+}
+
+/*
+ * Moves the cursor of a scrollable statement to the row given by
+ * orientation and offset and returns it as a vector, reusing row as
+ * Scm_oracle_stmt_fetch_row does. Returns #f if there is no such row.
+ * Rows are fetched define_rows at a time into the column handles, so
+ * moving to a row near the last one fetched doesn't make a round trip.
+ */
+ScmObj Scm_oracle_stmt_scroll(Scm_OCIError *err, Scm_OCIStmt *stmt, int orientation, int offset, ScmObj row)
+{
+    sb4 target;
+    sb4 start;
+    ub4 rows;
+    sword rv;
+
+    if (stmt->stmtp == NULL) {
+        Scm_Error("statement is already closed");
+    }
+    if (!stmt->scrollable) {
+        Scm_Error("statement is not scrollable");
+    }
+    switch (orientation) {
+    case OCI_FETCH_CURRENT:
+        target = stmt->position;
+        break;
+    case OCI_FETCH_NEXT:
+        target = stmt->position + 1;
+        break;
+    case OCI_FETCH_PRIOR:
+        target = stmt->position - 1;
+        break;
+    case OCI_FETCH_FIRST:
+        target = 1;
+        break;
+    case OCI_FETCH_LAST:
+        target = 0; /* unknown until fetched */
+        break;
+    case OCI_FETCH_ABSOLUTE:
+        target = offset;
+        break;
+    case OCI_FETCH_RELATIVE:
+        target = stmt->position + offset;
+        break;
+    default:
+        Scm_Error("invalid fetch orientation: %d", orientation);
+    }
+    if (orientation != OCI_FETCH_LAST) {
+        if (target < 1) {
+            return SCM_FALSE;
+        }
+        if (stmt->rows_fetched > 0) {
+            sb4 first = stmt->position - stmt->cur_row;
+
+            if (first <= target && target < first + (sb4)stmt->rows_fetched) {
+                stmt->cur_row = target - first;
+                stmt->position = target;
+                return current_row(stmt, row);
+            }
+        }
+        /* fetch the rows ending at the target when moving backward */
+        start = target;
+        if (target < (sb4)stmt->position && target > (sb4)stmt->define_rows) {
+            start = target - stmt->define_rows + 1;
+        }
+        rv = stmt_fetch(err, stmt, stmt->define_rows, OCI_FETCH_ABSOLUTE, start);
+    } else {
+        start = 0;
+        rv = stmt_fetch(err, stmt, 1, OCI_FETCH_LAST, 0);
+    }
+    if (rv != OCI_SUCCESS && rv != OCI_NO_DATA) {
+        RAISE_ERROR(rv, err);
+    }
+    stmt->eof = (rv == OCI_NO_DATA);
+    rv = OCIAttrGet(stmt->stmtp, OCI_HTYPE_STMT, &rows, NULL, OCI_ATTR_ROWS_FETCHED, err->errhp);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    count_rows(stmt, rows);
+    if (orientation == OCI_FETCH_LAST && rows > 0) {
+        ub4 last;
+
+        rv = OCIAttrGet(stmt->stmtp, OCI_HTYPE_STMT, &last, NULL, OCI_ATTR_CURRENT_POSITION, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        start = target = last;
+    }
+    if (target - start >= (sb4)rows) {
+        /* beyond the last row */
+        stmt->rows_fetched = 0;
+        stmt->cur_row = 0;
+        stmt->eof = TRUE;
+        return SCM_FALSE;
+    }
+    stmt->rows_fetched = rows;
+    stmt->cur_row = target - start;
+    stmt->position = target;
+    return current_row(stmt, row);
+}
+
+/*
+ * Returns the position of the current row, which starts from 1.
+ * It is 0 before the first row is fetched.
+ */
+ScmObj Scm_oracle_stmt_position(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    return Scm_MakeIntegerU(stmt->position);
+}
+
+/*
+ * Makes a column of the rows in the buffer of the column handle.
+ * Numbers are copied from the buffer into an s64vector or an f64vector
+ * without boxing and the other values are converted to a vector.
+ */
+static ScmObj column_vector(bind_handle_t *hndl, ub4 rows)
+{
+    ScmObj vec;
+    ub4 row;
+
+    switch (hndl->vptr->dty) {
+    case SQLT_INT:
+        vec = Scm_MakeS64Vector(rows, 0);
+        for (row = 0; row < rows; row++) {
+            if (hndl->ind[row] == 0) {
+                SCM_S64VECTOR_ELEMENTS(vec)[row] = ((long*)hndl->valuep)[row];
+            }
+        }
+        break;
+    case SQLT_FLT:
+    case SQLT_BDOUBLE:
+        vec = Scm_MakeF64Vector(rows, 0.0);
+        for (row = 0; row < rows; row++) {
+            if (hndl->ind[row] == 0) {
+                SCM_F64VECTOR_ELEMENTS(vec)[row] = ((double*)hndl->valuep)[row];
+            }
+        }
+        break;
+    case SQLT_BFLOAT:
+        vec = Scm_MakeF64Vector(rows, 0.0);
+        for (row = 0; row < rows; row++) {
+            if (hndl->ind[row] == 0) {
+                SCM_F64VECTOR_ELEMENTS(vec)[row] = ((float*)hndl->valuep)[row];
+            }
+        }
+        break;
+    default:
+        vec = Scm_MakeVector(rows, SCM_NIL);
+        for (row = 0; row < rows; row++) {
+            SCM_VECTOR_ELEMENTS(vec)[row] = hndl->vptr->get(hndl, row);
+        }
+    }
+    return vec;
+}
+
+/*
+ * Fetches the next define_rows rows column by column. INTEGER, REAL
+ * and BINARY_DOUBLE columns are fetched directly into the memory of
+ * s64vectors and f64vectors, BINARY_FLOAT columns are converted to
+ * f64vectors and the others to vectors. Returns a pair of a vector of
+ * the columns and a vector of u8vectors whose elements are 1 for NULL
+ * and 0 otherwise. The columns are empty at the end of the result set.
+ */
+ScmObj Scm_oracle_stmt_fetch_columns(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    ub4 nrows = stmt->define_rows;
+    ub4 count = stmt->column_count;
+    ScmObj columns = Scm_MakeVector(count, SCM_FALSE);
+    ScmObj nulls = Scm_MakeVector(count, SCM_FALSE);
+    ub4 rows = 0;
+    ub4 pos;
+    ub4 row;
+    sword rv = OCI_SUCCESS;
+    sword rv2;
+
+    if (stmt->stmtp == NULL) {
+        Scm_Error("statement is already closed");
+    }
+    if (stmt->cur_row + 1 < stmt->rows_fetched && !stmt->row_ready) {
+        Scm_Error("rows fetched by oracle-stmt-fetch are not read yet");
+    }
+    if (stmt->row_ready) {
+        /* the rows of a nonblocking fetch are in the column handles. */
+        rows = stmt->rows_fetched;
+        stmt->row_ready = FALSE;
+        if (rows > 0) {
+            /* fetched() counted the first row. */
+            stmt->position += rows - 1;
+        }
+    }
+    stmt->rows_fetched = 0;
+    stmt->cur_row = 0;
+    if (!stmt->eof && rows == 0) {
+        for (pos = 0; pos < count; pos++) {
+            bind_handle_t *hndl = get_column_handle(stmt, pos);
+            ScmObj vec;
+
+            if (hndl->vptr == NULL) {
+                Scm_Error("column %d is not defined", pos);
+            }
+            switch (hndl->vptr->dty) {
+            case SQLT_INT:
+                vec = Scm_MakeS64Vector(nrows, 0);
+                rv = define_column(err, stmt, pos, SCM_S64VECTOR_ELEMENTS(vec), sizeof(ScmInt64));
+                break;
+            case SQLT_FLT:
+            case SQLT_BDOUBLE:
+                vec = Scm_MakeF64Vector(nrows, 0.0);
+                rv = define_column(err, stmt, pos, SCM_F64VECTOR_ELEMENTS(vec), sizeof(double));
+                break;
+            default:
+                vec = SCM_FALSE;
+            }
+            if (rv != OCI_SUCCESS) {
+                break;
+            }
+            SCM_VECTOR_ELEMENTS(columns)[pos] = vec;
+        }
+        if (rv == OCI_SUCCESS) {
+            rv = stmt_fetch(err, stmt, nrows, OCI_FETCH_NEXT, 0);
+            if (rv == OCI_NO_DATA) {
+                stmt->eof = TRUE;
+                rv = OCI_SUCCESS;
+            }
+            if (rv == OCI_SUCCESS) {
+                rv = OCIAttrGet(stmt->stmtp, OCI_HTYPE_STMT, &rows, NULL, OCI_ATTR_ROWS_FETCHED, err->errhp);
+            }
+        }
+        /* point the defines at the column handles again. */
+        for (pos = 0; pos < count; pos++) {
+            bind_handle_t *hndl = &stmt->column_handles[pos];
+
+            if (!SCM_FALSEP(SCM_VECTOR_ELEMENTS(columns)[pos])) {
+                rv2 = define_column(err, stmt, pos, hndl->valuep, hndl->value_sz);
+                if (rv == OCI_SUCCESS) {
+                    rv = rv2;
+                }
+            }
+        }
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        count_rows(stmt, rows);
+        stmt->position += rows;
+    }
+    for (pos = 0; pos < count; pos++) {
+        bind_handle_t *hndl = get_column_handle(stmt, pos);
+        ScmObj vec = SCM_VECTOR_ELEMENTS(columns)[pos];
+        ScmObj nullmap = Scm_MakeU8Vector(rows, 0);
+
+        for (row = 0; row < rows; row++) {
+            if (hndl->ind[row] != 0) {
+                SCM_U8VECTOR_ELEMENTS(nullmap)[row] = 1;
+            }
+        }
+        if (SCM_FALSEP(vec)) {
+            vec = column_vector(hndl, rows);
+        } else if (rows < nrows) {
+            /* shrink the last batch */
+            ScmObj newvec;
+
+            if (SCM_S64VECTORP(vec)) {
+                newvec = Scm_MakeS64Vector(rows, 0);
+            } else {
+                newvec = Scm_MakeF64Vector(rows, 0.0);
+            }
+            memcpy(SCM_UVECTOR_ELEMENTS(newvec), SCM_UVECTOR_ELEMENTS(vec), rows * 8);
+            vec = newvec;
+        }
+        SCM_VECTOR_ELEMENTS(columns)[pos] = vec;
+        SCM_VECTOR_ELEMENTS(nulls)[pos] = nullmap;
+    }
+    return Scm_Cons(columns, nulls);
+}
+
+/*
+ * Discards the rest of the result set and frees the cursor on the server.
+ */
+ScmObj Scm_oracle_stmt_cancel(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    sword rv;
+
+    /* the cursor of a scrollable statement is open after the last row */
+    if (stmt->stmtp == NULL || (stmt->eof && !stmt->scrollable)) {
+        return SCM_NIL;
+    }
+    stmt->rows_fetched = 0;
+    stmt->cur_row = 0;
+    stmt->eof = TRUE;
+    rv = stmt_fetch(err, stmt, 0, OCI_FETCH_NEXT, 0);
+    if (rv != OCI_SUCCESS && rv != OCI_NO_DATA) {
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_NIL;
+}
+
+ScmObj Scm_oracle_stmt_type(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    ub2 stmt_type;
+    sword rv = get_stmt_type(err, stmt, &stmt_type);
+
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_MAKE_INT(stmt_type);
+}
+
+ScmObj Scm_oracle_stmt_row_count(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    return get_ub4_attr(err, stmt->stmtp, OCI_HTYPE_STMT, OCI_ATTR_ROW_COUNT);
+}
+
+/*
+ * Returns the maximum bytes of a character in the client character set.
+ */
+static sb4 get_charset_maxbytes(Scm_OCIError *err)
+{
+    static sb4 charset_maxbytes = 0;
+
+    if (charset_maxbytes == 0) {
+        sword rv = OCINlsNumericInfoGet(envhp, err->errhp, &charset_maxbytes, OCI_NLS_CHARSET_MAXBYTESZ);
+
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+    }
+    return charset_maxbytes;
+}
+
+/*
+ * Returns the size of the buffer to fetch the column as a string
+ * in the client character set.
+ */
+static ub4 define_size(Scm_OCIParamMetadata *param, sb4 charset_maxbytes)
+{
+    ub4 size;
+
+    switch (param->data_type) {
+    case SQLT_CHR:
+    case SQLT_AFC:
+        /* char_size is the length in characters for both semantics. */
+        size = (param->char_size ? param->char_size : param->data_size) * charset_maxbytes;
+        break;
+    case SQLT_BIN:
+        /* RAW is fetched as a hexadecimal string. */
+        size = param->data_size * 2;
+        break;
+    case SQLT_LNG:
+    case SQLT_LBI:
+        size = LONG_DEFINE_SIZE;
+        break;
+    default:
+        /* the text form of other types isn't bounded by data_size. */
+        return 4000;
+    }
+    return size > 0 ? size : 1;
+}
+
+/*
+ * Returns the metadata of the columns. It is got once per statement.
+ */
+ScmObj Scm_oracle_stmt_params(Scm_OCIError *err, Scm_OCIStmt *stmt)
+{
+    sb4 charset_maxbytes;
+    ScmObj params;
+    ub4 pos;
+    sword rv;
+
+    if (SCM_VECTORP(stmt->params)) {
+        return stmt->params;
+    }
+    params = Scm_MakeVector(stmt->column_count, SCM_NIL);
+    charset_maxbytes = get_charset_maxbytes(err);
+
+    for (pos = 0; pos < stmt->column_count; pos++) {
+        Scm_OCIParamMetadata *param = SCM_NEW(Scm_OCIParamMetadata);
+        OCIParam *parmhp = NULL;
+        union {
+            char *_text;
+            ub2 _ub2;
+            sb2 _sb2;
             sb1 _sb1;
+            ub1 _ub1;
         } val;
         ub4 size;
 
-        SCM_SET_CLASS(param, SCM_CLASS_OCIPARAMMETADATA);
+        SCM_SET_CLASS(param, SCM_CLASS_OCIPARAMMETADATA);
+
+        /* get parameter */
+        rv = OCIParamGet(stmt->stmtp, OCI_HTYPE_STMT, err->errhp, (dvoid*)&parmhp, pos + 1);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+
+        /* get name */
+        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, &size, OCI_ATTR_NAME, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        param->name = Scm_MakeString(val._text, size, -1, SCM_STRING_COPYING);
+
+        /* get data_type */
+        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_DATA_TYPE, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        param->data_type = val._ub2;
+
+        /* get data_size */
+        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_DATA_SIZE, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        param->data_size = val._ub2;
+
+        /* get char_size */
+        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_CHAR_SIZE, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        param->char_size = val._ub2;
+
+        /* get char_used */
+        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_CHAR_USED, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        param->char_used = val._ub1;
+
+        /* get precision */
+        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_PRECISION, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        param->precision = val._sb2;
+
+        /* get scale */
+        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_SCALE, err->errhp);
+        if (rv != OCI_SUCCESS) {
+            RAISE_ERROR(rv, err);
+        }
+        param->scale = val._sb1;
+
+        param->define_size = define_size(param, charset_maxbytes);
+
+        Scm_VectorSet(SCM_VECTOR(params), pos, SCM_OBJ(param));
+    }
+    stmt->params = params;
+    return params;
+}
+
+static void dirpath_free(Scm_OCIDirPath *dp)
+{
+    if (dp->dpstr != NULL) {
+        OCIHandleFree(dp->dpstr, OCI_HTYPE_DIRPATH_STREAM);
+        dp->dpstr = NULL;
+    }
+    if (dp->dpca != NULL) {
+        OCIHandleFree(dp->dpca, OCI_HTYPE_DIRPATH_COLUMN_ARRAY);
+        dp->dpca = NULL;
+    }
+    if (dp->dpctx != NULL) {
+        OCIHandleFree(dp->dpctx, OCI_HTYPE_DIRPATH_CTX);
+        dp->dpctx = NULL;
+    }
+    free(dp->types);
+    dp->types = NULL;
+    free(dp->values);
+    dp->values = NULL;
+}
+
+static void dirpath_finalize(ScmObj obj, void *data)
+{
+    Scm_OCIDirPath *dp = (Scm_OCIDirPath *)obj;
+
+    if (dp->dpctx != NULL && dp->svc->svchp != NULL) {
+        /* discard the rows of a load which is neither finished nor aborted. */
+        OCIError *errhp;
+
+        if (OCIHandleAlloc(envhp, (dvoid**)&errhp, OCI_HTYPE_ERROR, 0, NULL) == OCI_SUCCESS) {
+            OCIDirPathAbort(dp->dpctx, errhp);
+            OCIHandleFree(errhp, OCI_HTYPE_ERROR);
+        }
+    }
+    dirpath_free(dp);
+}
+
+/*
+ * Sets the attributes of a column of a direct path load. columns is
+ * a list of (name type size dateformat). type is BIND_STRING,
+ * BIND_INTEGER or BIND_REAL. Dates and timestamps are loaded from
+ * strings in dateformat.
+ */
+static sword dirpath_set_column(Scm_OCIError *err, Scm_OCIDirPath *dp, OCIParam *collist, ub2 col, ScmObj column)
+{
+    OCIParam *colp = NULL;
+    ScmObj name, fmt;
+    const char *str;
+    u_int size;
+    ub2 dty;
+    ub4 data_size;
+    sword rv;
+
+    if (Scm_Length(column) != 4 || !SCM_STRINGP(SCM_CAR(column))
+        || !SCM_INTP(SCM_CADR(column)) || !SCM_INTP(SCM_CAR(SCM_CDDR(column)))) {
+        Scm_Error("(name type size dateformat) required, but got %S", column);
+    }
+    name = SCM_CAR(column);
+    dp->types[col] = SCM_INT_VALUE(SCM_CADR(column));
+    fmt = SCM_CADR(SCM_CDDR(column));
+    switch (dp->types[col]) {
+    case BIND_INTEGER:
+        dty = SQLT_INT;
+        data_size = sizeof(ScmInt64);
+        break;
+    case BIND_REAL:
+        dty = SQLT_FLT;
+        data_size = sizeof(double);
+        break;
+    case BIND_STRING:
+        dty = SQLT_CHR;
+        data_size = SCM_INT_VALUE(SCM_CAR(SCM_CDDR(column)));
+        break;
+    default:
+        Scm_Error("unsupported column type for direct path load: %d", dp->types[col]);
+    }
+
+    rv = OCIParamGet(collist, OCI_DTYPE_PARAM, err->errhp, (dvoid**)&colp, col + 1);
+    if (rv != OCI_SUCCESS) {
+        return rv;
+    }
+    str = Scm_GetStringContent(SCM_STRING(name), &size, NULL, NULL);
+    rv = OCIAttrSet(colp, OCI_DTYPE_PARAM, (dvoid*)str, size, OCI_ATTR_NAME, err->errhp);
+    if (rv == OCI_SUCCESS) {
+        rv = OCIAttrSet(colp, OCI_DTYPE_PARAM, &dty, sizeof(dty), OCI_ATTR_DATA_TYPE, err->errhp);
+    }
+    if (rv == OCI_SUCCESS) {
+        rv = OCIAttrSet(colp, OCI_DTYPE_PARAM, &data_size, sizeof(data_size), OCI_ATTR_DATA_SIZE, err->errhp);
+    }
+    if (rv == OCI_SUCCESS && SCM_STRINGP(fmt)) {
+        str = Scm_GetStringContent(SCM_STRING(fmt), &size, NULL, NULL);
+        rv = OCIAttrSet(colp, OCI_DTYPE_PARAM, (dvoid*)str, size, OCI_ATTR_DATEFORMAT, err->errhp);
+    }
+    OCIDescriptorFree(colp, OCI_DTYPE_PARAM);
+    return rv;
+}
+
+/*
+ * Prepares a direct path load of the columns of a table. rows is the
+ * number of rows of the column array and buf_size the size of the
+ * stream buffer. Zero means OCI's default.
+ */
+ScmObj Scm_oracle_dirpath_prepare(Scm_OCIError *err, Scm_OCISvcCtx *svc, ScmObj schema, const char *table,
+                                  ScmObj columns, u_int rows, u_int buf_size)
+{
+    Scm_OCIDirPath *dp = SCM_NEW(Scm_OCIDirPath);
+    OCIParam *collist = NULL;
+    int ncols = Scm_Length(columns);
+    ScmObj lp;
+    ub2 col;
+    sword rv;
+
+    if (ncols <= 0) {
+        Scm_Error("list of columns required, but got %S", columns);
+    }
+
+    dp->dpctx = NULL;
+    dp->dpca = NULL;
+    dp->dpstr = NULL;
+    dp->svc = svc;
+    dp->column_count = ncols;
+    dp->types = calloc(ncols, sizeof(int));
+    dp->max_rows = 0;
+    dp->values = NULL;
+    dp->row_count = 0;
+    if (dp->types == NULL) {
+        Scm_Error("failed to allocate %d column types", ncols);
+    }
+    SCM_SET_CLASS(dp, SCM_CLASS_OCIDIRPATH);
+    Scm_RegisterFinalizer(SCM_OBJ(dp), dirpath_finalize, NULL);
+
+    rv = OCIHandleAlloc(envhp, (dvoid**)&dp->dpctx, OCI_HTYPE_DIRPATH_CTX, 0, NULL);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ALLOC_ERROR(rv);
+    }
+    rv = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, (dvoid*)table, strlen(table), OCI_ATTR_NAME, err->errhp);
+    if (rv == OCI_SUCCESS && SCM_STRINGP(schema)) {
+        u_int size;
+        const char *str = Scm_GetStringContent(SCM_STRING(schema), &size, NULL, NULL);
+
+        rv = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, (dvoid*)str, size, OCI_ATTR_SCHEMA_NAME, err->errhp);
+    }
+    if (rv == OCI_SUCCESS) {
+        rv = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, &dp->column_count, sizeof(ub2), OCI_ATTR_NUM_COLS, err->errhp);
+    }
+    if (rv == OCI_SUCCESS && rows > 0) {
+        ub4 val = rows;
+        rv = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, &val, sizeof(val), OCI_ATTR_NUM_ROWS, err->errhp);
+    }
+    if (rv == OCI_SUCCESS && buf_size > 0) {
+        ub4 val = buf_size;
+        rv = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, &val, sizeof(val), OCI_ATTR_BUF_SIZE, err->errhp);
+    }
+    if (rv == OCI_SUCCESS) {
+        rv = OCIAttrGet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, &collist, NULL, OCI_ATTR_LIST_COLUMNS, err->errhp);
+    }
+    col = 0;
+    SCM_FOR_EACH(lp, columns) {
+        if (rv != OCI_SUCCESS) {
+            break;
+        }
+        rv = dirpath_set_column(err, dp, collist, col++, SCM_CAR(lp));
+    }
+    if (rv == OCI_SUCCESS) {
+        rv = OCIDirPathPrepare(dp->dpctx, svc->svchp, err->errhp);
+    }
+    if (rv != OCI_SUCCESS) {
+        dirpath_free(dp);
+        RAISE_ERROR(rv, err);
+    }
+
+    rv = OCIHandleAlloc(dp->dpctx, (dvoid**)&dp->dpca, OCI_HTYPE_DIRPATH_COLUMN_ARRAY, 0, NULL);
+    if (rv == OCI_SUCCESS) {
+        rv = OCIHandleAlloc(dp->dpctx, (dvoid**)&dp->dpstr, OCI_HTYPE_DIRPATH_STREAM, 0, NULL);
+    }
+    if (rv != OCI_SUCCESS) {
+        dirpath_finalize(SCM_OBJ(dp), NULL);
+        RAISE_ALLOC_ERROR(rv);
+    }
+    /* the column array may have fewer rows than requested. */
+    rv = OCIAttrGet(dp->dpca, OCI_HTYPE_DIRPATH_COLUMN_ARRAY, &dp->max_rows, NULL, OCI_ATTR_NUM_ROWS, err->errhp);
+    if (rv != OCI_SUCCESS) {
+        dirpath_finalize(SCM_OBJ(dp), NULL);
+        RAISE_ERROR(rv, err);
+    }
+    dp->values = malloc(sizeof(dirpath_value_t) * dp->max_rows * dp->column_count);
+    if (dp->values == NULL) {
+        dirpath_finalize(SCM_OBJ(dp), NULL);
+        Scm_Error("failed to allocate %u rows of %d columns", dp->max_rows, ncols);
+    }
+    return SCM_OBJ(dp);
+}
 
-        /* get parameter */
-        rv = OCIParamGet(stmt->stmtp, OCI_HTYPE_STMT, err->errhp, (dvoid*)&parmhp, pos + 1);
-        if (rv != OCI_SUCCESS) {
-            return ERROR(rv, err);
+static void check_dirpath(Scm_OCIDirPath *dp)
+{
+    if (dp->dpctx == NULL) {
+        Scm_Error("direct path load is already finished or aborted");
+    }
+}
+
+/*
+ * Sets a value to the column array. Strings are passed without being
+ * copied, so they must be alive until the array is converted to a
+ * stream.
+ */
+static void dirpath_set(Scm_OCIError *err, Scm_OCIDirPath *dp, ub4 idx, ub2 col, ScmObj val)
+{
+    dirpath_value_t *v = &dp->values[(size_t)col * dp->max_rows + idx];
+    ub1 *p = NULL;
+    ub4 len = 0;
+    ub1 flag = OCI_DIRPATH_COL_COMPLETE;
+    sword rv;
+
+    if (SCM_NULLP(val)) {
+        flag = OCI_DIRPATH_COL_NULL;
+    } else {
+        switch (dp->types[col]) {
+        case BIND_INTEGER:
+            if (!SCM_INTEGERP(val)) {
+                Scm_Error("neither integer nor null: %S", val);
+            }
+            v->i = Scm_GetInteger64(val);
+            p = (ub1*)&v->i;
+            len = sizeof(v->i);
+            break;
+        case BIND_REAL:
+            if (!SCM_REALP(val)) {
+                Scm_Error("neither real nor null: %S", val);
+            }
+            v->d = Scm_GetDouble(val);
+            p = (ub1*)&v->d;
+            len = sizeof(v->d);
+            break;
+        default:
+            if (!SCM_STRINGP(val)) {
+                Scm_Error("neither string nor null: %S", val);
+            } else {
+                u_int size;
+
+                p = (ub1*)Scm_GetStringContent(SCM_STRING(val), &size, NULL, NULL);
+                len = size;
+            }
+            break;
         }
+    }
+    rv = OCIDirPathColArrayEntrySet(dp->dpca, err->errhp, idx, col, p, len, flag);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+}
 
-        /* get name */
-        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, &size, OCI_ATTR_NAME, err->errhp);
-        if (rv != OCI_SUCCESS) {
-            return ERROR(rv, err);
+/*
+ * Converts the first nrows rows of the column array to the stream and
+ * loads it. When the stream gets full, the rows converted so far are
+ * loaded and the rest are converted again.
+ */
+static void dirpath_load(Scm_OCIError *err, Scm_OCIDirPath *dp, ub4 nrows)
+{
+    ub4 rowoff = 0;
+    ub4 converted;
+    sword rv;
+    sword rv2;
+
+    for (;;) {
+        rv = OCIDirPathColArrayToStream(dp->dpca, dp->dpctx, dp->dpstr, err->errhp, nrows, rowoff);
+        if (rv != OCI_SUCCESS && rv != OCI_CONTINUE) {
+            RAISE_ERROR(rv, err);
         }
-        param->name = Scm_MakeString(val._text, size, -1, SCM_STRING_COPYING);
+        rv2 = OCIDirPathLoadStream(dp->dpctx, dp->dpstr, err->errhp);
+        if (rv2 != OCI_SUCCESS) {
+            RAISE_ERROR(rv2, err);
+        }
+        rv2 = OCIDirPathStreamReset(dp->dpstr, err->errhp);
+        if (rv2 != OCI_SUCCESS) {
+            RAISE_ERROR(rv2, err);
+        }
+        if (rv == OCI_SUCCESS) {
+            break;
+        }
+        rv2 = OCIAttrGet(dp->dpca, OCI_HTYPE_DIRPATH_COLUMN_ARRAY, &converted, NULL, OCI_ATTR_ROW_COUNT, err->errhp);
+        if (rv2 != OCI_SUCCESS) {
+            RAISE_ERROR(rv2, err);
+        }
+        rowoff += converted;
+    }
+    rv = OCIDirPathColArrayReset(dp->dpca, err->errhp);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    dp->row_count += nrows;
+}
 
-        /* get data_type */
-        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_DATA_TYPE, err->errhp);
-        if (rv != OCI_SUCCESS) {
-            return ERROR(rv, err);
+/*
+ * Loads a list of rows, each of which is a vector or a list of the
+ * values of the columns.
+ */
+ScmObj Scm_oracle_dirpath_load_rows(Scm_OCIError *err, Scm_OCIDirPath *dp, ScmObj rows)
+{
+    ScmObj lp;
+    ub4 idx = 0;
+    ub2 col;
+
+    check_dirpath(dp);
+    SCM_FOR_EACH(lp, rows) {
+        ScmObj row = SCM_CAR(lp);
+
+        if (SCM_VECTORP(row) && SCM_VECTOR_SIZE(row) == dp->column_count) {
+            for (col = 0; col < dp->column_count; col++) {
+                dirpath_set(err, dp, idx, col, SCM_VECTOR_ELEMENTS(row)[col]);
+            }
+        } else if (Scm_Length(row) == dp->column_count) {
+            for (col = 0; col < dp->column_count; col++) {
+                dirpath_set(err, dp, idx, col, SCM_CAR(row));
+                row = SCM_CDR(row);
+            }
+        } else {
+            Scm_Error("vector or list of %d values required, but got %S", dp->column_count, row);
         }
-        param->data_type = val._ub2;
+        if (++idx == dp->max_rows) {
+            dirpath_load(err, dp, idx);
+            idx = 0;
+        }
+    }
+    if (idx > 0) {
+        dirpath_load(err, dp, idx);
+    }
+    return Scm_MakeIntegerU(dp->row_count);
+}
 
-        /* get data_size */
-        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_DATA_SIZE, err->errhp);
-        if (rv != OCI_SUCCESS) {
-            return ERROR(rv, err);
+/*
+ * Loads columns of the same length. columns is a vector of vectors,
+ * s64vectors of integer columns or f64vectors of real columns, which
+ * are passed to OCI without conversion. nulls is #f or a vector of
+ * u8vectors, or #f for a column without nulls, in which 1 means NULL.
+ */
+ScmObj Scm_oracle_dirpath_load_columns(Scm_OCIError *err, Scm_OCIDirPath *dp, ScmObj columns, ScmObj nulls)
+{
+    ScmObj *cols;
+    ub4 n = 0;
+    ub4 start;
+    ub4 idx;
+    ub4 cnt;
+    ub2 col;
+    sword rv;
+
+    check_dirpath(dp);
+    if (!SCM_VECTORP(columns) || SCM_VECTOR_SIZE(columns) != dp->column_count) {
+        Scm_Error("vector of %d columns required, but got %S", dp->column_count, columns);
+    }
+    if (!SCM_FALSEP(nulls) && (!SCM_VECTORP(nulls) || SCM_VECTOR_SIZE(nulls) != dp->column_count)) {
+        Scm_Error("vector of %d null maps required, but got %S", dp->column_count, nulls);
+    }
+    cols = SCM_VECTOR_ELEMENTS(columns);
+    for (col = 0; col < dp->column_count; col++) {
+        ScmObj vec = cols[col];
+        ub4 len;
+
+        if (SCM_VECTORP(vec)) {
+            len = SCM_VECTOR_SIZE(vec);
+        } else if ((SCM_S64VECTORP(vec) && dp->types[col] == BIND_INTEGER)
+                   || (SCM_F64VECTORP(vec) && dp->types[col] == BIND_REAL)) {
+            len = SCM_UVECTOR_SIZE(vec);
+        } else {
+            Scm_Error("invalid values of column %d: %S", col, vec);
         }
-        param->data_size = val._ub2;
+        if (col == 0) {
+            n = len;
+        } else if (len != n) {
+            Scm_Error("column %d has %u values for %u", col, len, n);
+        }
+        if (SCM_VECTORP(nulls)) {
+            ScmObj nullmap = SCM_VECTOR_ELEMENTS(nulls)[col];
 
-        /* get precision */
-        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_PRECISION, err->errhp);
-        if (rv != OCI_SUCCESS) {
-            return ERROR(rv, err);
+            if (!SCM_FALSEP(nullmap) && (!SCM_U8VECTORP(nullmap) || SCM_UVECTOR_SIZE(nullmap) != n)) {
+                Scm_Error("u8vector of %u elements or #f required, but got %S", n, nullmap);
+            }
         }
-        param->precision = val._sb2;
+    }
 
-        /* get scale */
-        rv = OCIAttrGet(parmhp, OCI_DTYPE_PARAM, &val, NULL, OCI_ATTR_SCALE, err->errhp);
-        if (rv != OCI_SUCCESS) {
-            return ERROR(rv, err);
+    for (start = 0; start < n; start += cnt) {
+        cnt = (n - start < dp->max_rows) ? n - start : dp->max_rows;
+        for (col = 0; col < dp->column_count; col++) {
+            ScmObj vec = cols[col];
+            ScmObj nullmap = SCM_VECTORP(nulls) ? SCM_VECTOR_ELEMENTS(nulls)[col] : SCM_FALSE;
+            const unsigned char *isnull = SCM_FALSEP(nullmap) ? NULL : SCM_U8VECTOR_ELEMENTS(nullmap) + start;
+
+            for (idx = 0; idx < cnt; idx++) {
+                if (isnull != NULL && isnull[idx]) {
+                    rv = OCIDirPathColArrayEntrySet(dp->dpca, err->errhp, idx, col, NULL, 0, OCI_DIRPATH_COL_NULL);
+                } else if (SCM_S64VECTORP(vec)) {
+                    rv = OCIDirPathColArrayEntrySet(dp->dpca, err->errhp, idx, col,
+                                                    (ub1*)&SCM_S64VECTOR_ELEMENTS(vec)[start + idx],
+                                                    sizeof(ScmInt64), OCI_DIRPATH_COL_COMPLETE);
+                } else if (SCM_F64VECTORP(vec)) {
+                    rv = OCIDirPathColArrayEntrySet(dp->dpca, err->errhp, idx, col,
+                                                    (ub1*)&SCM_F64VECTOR_ELEMENTS(vec)[start + idx],
+                                                    sizeof(double), OCI_DIRPATH_COL_COMPLETE);
+                } else {
+                    dirpath_set(err, dp, idx, col, SCM_VECTOR_ELEMENTS(vec)[start + idx]);
+                    continue;
+                }
+                if (rv != OCI_SUCCESS) {
+                    RAISE_ERROR(rv, err);
+                }
+            }
         }
-        param->scale = val._sb1;
+        dirpath_load(err, dp, cnt);
+    }
+    return Scm_MakeIntegerU(dp->row_count);
+}
 
-        Scm_VectorSet(SCM_VECTOR(params), pos, SCM_OBJ(param));
+/*
+ * Finishes the load and saves the rows. Returns the number of rows
+ * loaded.
+ */
+ScmObj Scm_oracle_dirpath_finish(Scm_OCIError *err, Scm_OCIDirPath *dp)
+{
+    sword rv;
+
+    check_dirpath(dp);
+    rv = OCIDirPathFinish(dp->dpctx, err->errhp);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    dirpath_free(dp);
+    return Scm_MakeIntegerU(dp->row_count);
+}
+
+/*
+ * Discards the rows loaded. It does nothing after the load is
+ * finished or aborted.
+ */
+ScmObj Scm_oracle_dirpath_abort(Scm_OCIError *err, Scm_OCIDirPath *dp)
+{
+    sword rv;
+
+    if (dp->dpctx == NULL) {
+        return SCM_NIL;
+    }
+    rv = OCIDirPathAbort(dp->dpctx, err->errhp);
+    dirpath_free(dp);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, err);
+    }
+    return SCM_NIL;
+}
+
+ScmObj Scm_oracle_dirpath_row_count(Scm_OCIError *err, Scm_OCIDirPath *dp)
+{
+    return Scm_MakeIntegerU(dp->row_count);
+}
+
+static void lob_finalize(ScmObj obj, void *data)
+{
+    Scm_OCILob *lob = (Scm_OCILob *)obj;
+
+    if (lob->locp != NULL) {
+        if (lob->svc->svchp != NULL) {
+            OCIError *errhp;
+
+            if (OCIHandleAlloc(envhp, (dvoid**)&errhp, OCI_HTYPE_ERROR, 0, NULL) == OCI_SUCCESS) {
+                boolean is_temp = FALSE;
+
+                if (OCILobIsTemporary(envhp, errhp, lob->locp, &is_temp) == OCI_SUCCESS && is_temp) {
+                    OCILobFreeTemporary(lob->svc->svchp, errhp, lob->locp);
+                }
+                OCIHandleFree(errhp, OCI_HTYPE_ERROR);
+            }
+        }
+        OCIDescriptorFree(lob->locp, OCI_DTYPE_LOB);
+        lob->locp = NULL;
+    }
+}
+
+/*
+ * Makes an <oracle-lob> from a copy of the locator src, which is in a
+ * bind handle of stmt and overwritten by the next fetch.
+ */
+ScmObj Scm_oracle_make_lob(Scm_OCIStmt *stmt, OCILobLocator *src, int type)
+{
+    Scm_OCILob *lob = SCM_NEW(Scm_OCILob);
+    OCIError *errhp = stmt->err->errhp;
+    sword rv;
+
+    SCM_SET_CLASS(lob, SCM_CLASS_OCILOB);
+    lob->locp = NULL;
+    lob->svc = stmt->svc;
+    lob->err = NULL;
+    lob->type = type;
+    lob->csfrm = SQLCS_IMPLICIT;
+    Scm_RegisterFinalizer(SCM_OBJ(lob), lob_finalize, NULL);
+
+    rv = OCIDescriptorAlloc(envhp, (dvoid**)&lob->locp, OCI_DTYPE_LOB, 0, NULL);
+    if (rv != OCI_SUCCESS) {
+        lob->locp = NULL;
+        RAISE_ALLOC_ERROR(rv);
+    }
+    rv = OCILobLocatorAssign(stmt->svc->svchp, errhp, src, &lob->locp);
+    if (rv == OCI_SUCCESS && type == BIND_CLOB) {
+        rv = OCILobCharSetForm(envhp, errhp, lob->locp, &lob->csfrm);
+    }
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, stmt->err);
+    }
+    return SCM_OBJ(lob);
+}
+
+/*
+ * Copies the locator of the <oracle-lob> val to *dst to bind it.
+ */
+void Scm_oracle_lob_assign(Scm_OCIStmt *stmt, ScmObj val, OCILobLocator **dst)
+{
+    sword rv;
+
+    if (!SCM_ORACLE_LOB_P(val)) {
+        Scm_Error("neither <oracle-lob> nor null");
+    }
+    rv = OCILobLocatorAssign(stmt->svc->svchp, stmt->err->errhp, SCM_ORACLE_LOB(val)->locp, dst);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, stmt->err);
+    }
+}
+
+/*
+ * Frees the temporary LOB of locp made by Scm_oracle_stmt_bind_lob.
+ * Temporary LOBs are freed by the server when the connection is closed.
+ */
+void Scm_oracle_lob_free_temporary(Scm_OCIStmt *stmt, OCILobLocator *locp)
+{
+    OCIError *errhp = stmt->err != NULL ? stmt->err->errhp : NULL;
+    boolean is_temp = FALSE;
+
+    if (locp == NULL || stmt->svc->svchp == NULL) {
+        return;
+    }
+    if (errhp != NULL) {
+        if (OCILobIsTemporary(envhp, errhp, locp, &is_temp) == OCI_SUCCESS && is_temp) {
+            OCILobFreeTemporary(stmt->svc->svchp, errhp, locp);
+        }
+    } else if (OCIHandleAlloc(envhp, (dvoid**)&errhp, OCI_HTYPE_ERROR, 0, NULL) == OCI_SUCCESS) {
+        /* the statement is being finalized. */
+        if (OCILobIsTemporary(envhp, errhp, locp, &is_temp) == OCI_SUCCESS && is_temp) {
+            OCILobFreeTemporary(stmt->svc->svchp, errhp, locp);
+        }
+        OCIHandleFree(errhp, OCI_HTYPE_ERROR);
+    }
+}
+
+/*
+ * Checks that the LOB can be read and makes its error handle. A result
+ * makes a LOB for each CLOB and BLOB value fetched, most of which may
+ * never be read, so the handle isn't made until then.
+ */
+static void check_lob(Scm_OCILob *lob)
+{
+    if (lob->svc->svchp == NULL) {
+        Scm_Error("connection of the LOB is already closed");
+    }
+    if (lob->err == NULL) {
+        lob->err = SCM_ORACLE_ERROR(Scm_make_oracle_error());
+    }
+}
+
+/*
+ * Returns the length of the LOB in characters for a CLOB and in bytes
+ * for a BLOB.
+ */
+ScmObj Scm_oracle_lob_length(Scm_OCILob *lob)
+{
+    oraub8 len = 0;
+    sword rv;
+
+    check_lob(lob);
+    rv = OCILobGetLength2(lob->svc->svchp, lob->err->errhp, lob->locp, &len);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, lob->err);
+    }
+    return Scm_MakeIntegerU64(len);
+}
+
+/*
+ * Returns the chunk size of the LOB, the unit in which the server
+ * stores it, in characters for a CLOB and in bytes for a BLOB.
+ */
+static ub4 lob_chunk_size(Scm_OCILob *lob)
+{
+    ub4 size = 0;
+    sword rv;
+
+    check_lob(lob);
+    rv = OCILobGetChunkSize(lob->svc->svchp, lob->err->errhp, lob->locp, &size);
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, lob->err);
+    }
+    return size;
+}
+
+ScmObj Scm_oracle_lob_chunk_size(Scm_OCILob *lob)
+{
+    return Scm_MakeIntegerU(lob_chunk_size(lob));
+}
+
+/*
+ * Returns the bytes of a buffer which holds one chunk of the LOB
+ * in the client character set.
+ */
+ScmObj Scm_oracle_lob_buffer_size(Scm_OCILob *lob)
+{
+    ub4 size = lob_chunk_size(lob);
+
+    if (size == 0) {
+        size = LOB_DEFAULT_CHUNK_SIZE;
+    }
+    if (lob->type == BIND_CLOB) {
+        size *= get_charset_maxbytes(lob->err);
     }
-    return SUCCESS(params);
+    return Scm_MakeIntegerU(size);
+}
+
+/*
+ * Reads the LOB from offset, which starts at 1 and counts characters
+ * for a CLOB and bytes for a BLOB, into the u8vector buf. A CLOB is
+ * read in the client character set. Returns a pair of the bytes read
+ * and the characters or bytes to advance offset by, (0 . 0) at the end.
+ */
+ScmObj Scm_oracle_lob_read(Scm_OCILob *lob, ScmUInt64 offset, ScmObj buf)
+{
+    oraub8 byte_amt = 0;
+    oraub8 char_amt = 0;
+    ub4 bufl;
+    sword rv;
+
+    if (!SCM_U8VECTORP(buf)) {
+        Scm_Error("u8vector required, but got %S", buf);
+    }
+    check_lob(lob);
+    bufl = SCM_UVECTOR_SIZE(buf);
+    if (lob->type == BIND_CLOB) {
+        /* read as many characters as surely fit in buf. */
+        char_amt = bufl / get_charset_maxbytes(lob->err);
+        if (char_amt == 0) {
+            Scm_Error("too small buffer to read a CLOB: %u bytes", bufl);
+        }
+    } else {
+        byte_amt = bufl;
+    }
+    rv = OCILobRead2(lob->svc->svchp, lob->err->errhp, lob->locp, &byte_amt, &char_amt, offset,
+                     SCM_U8VECTOR_ELEMENTS(buf), bufl, OCI_ONE_PIECE, NULL, NULL, 0, lob->csfrm);
+    if (rv == OCI_NO_DATA) {
+        return Scm_Cons(SCM_MAKE_INT(0), SCM_MAKE_INT(0));
+    }
+    if (rv != OCI_SUCCESS) {
+        RAISE_ERROR(rv, lob->err);
+    }
+    return Scm_Cons(Scm_MakeIntegerU64(byte_amt),
+                    Scm_MakeIntegerU64(lob->type == BIND_CLOB ? char_amt : byte_amt));
 }
 
 static ScmObj param_metadata_get_name(ScmObj obj)
@@ -488,6 +3012,24 @@ static ScmObj param_metadata_get_data_size(ScmObj obj)
     return SCM_MAKE_INT(md->data_size);
 }
 
+static ScmObj param_metadata_get_char_size(ScmObj obj)
+{
+    Scm_OCIParamMetadata *md = (Scm_OCIParamMetadata*)obj;
+    return SCM_MAKE_INT(md->char_size);
+}
+
+static ScmObj param_metadata_get_char_used(ScmObj obj)
+{
+    Scm_OCIParamMetadata *md = (Scm_OCIParamMetadata*)obj;
+    return SCM_MAKE_BOOL(md->char_used);
+}
+
+static ScmObj param_metadata_get_define_size(ScmObj obj)
+{
+    Scm_OCIParamMetadata *md = (Scm_OCIParamMetadata*)obj;
+    return Scm_MakeIntegerU(md->define_size);
+}
+
 static ScmObj param_metadata_get_precision(ScmObj obj)
 {
     Scm_OCIParamMetadata *md = (Scm_OCIParamMetadata*)obj;
@@ -504,11 +3046,97 @@ static ScmClassStaticSlotSpec param_metadata_slots[] = {
     SCM_CLASS_SLOT_SPEC("name", param_metadata_get_name, NULL),
     SCM_CLASS_SLOT_SPEC("data-type", param_metadata_get_data_type, NULL),
     SCM_CLASS_SLOT_SPEC("data-size", param_metadata_get_data_size, NULL),
+    SCM_CLASS_SLOT_SPEC("char-size", param_metadata_get_char_size, NULL),
+    SCM_CLASS_SLOT_SPEC("char-used", param_metadata_get_char_used, NULL),
+    SCM_CLASS_SLOT_SPEC("define-size", param_metadata_get_define_size, NULL),
     SCM_CLASS_SLOT_SPEC("precision", param_metadata_get_precision, NULL),
     SCM_CLASS_SLOT_SPEC("scale", param_metadata_get_scale, NULL),
     SCM_CLASS_SLOT_SPEC_END()
 };
 
+static ScmObj make_stats(const oracle_stats_t *stats)
+{
+    Scm_OCIStats *obj = SCM_NEW(Scm_OCIStats);
+
+    SCM_SET_CLASS(obj, SCM_CLASS_OCISTATS);
+    obj->stats = *stats;
+    return SCM_OBJ(obj);
+}
+
+static ScmObj stats_get_prepare_time(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeFlonum(st->stats.prepare_time);
+}
+
+static ScmObj stats_get_execute_time(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeFlonum(st->stats.execute_time);
+}
+
+static ScmObj stats_get_fetch_time(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeFlonum(st->stats.fetch_time);
+}
+
+static ScmObj stats_get_executes(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeIntegerU(st->stats.executes);
+}
+
+static ScmObj stats_get_fetches(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeIntegerU(st->stats.fetches);
+}
+
+static ScmObj stats_get_rows(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeIntegerU(st->stats.rows);
+}
+
+static ScmObj stats_get_bytes(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeIntegerU(st->stats.bytes);
+}
+
+static ScmObj stats_get_bind_reallocs(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeIntegerU(st->stats.bind_reallocs);
+}
+
+static ScmObj stats_get_define_reallocs(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeIntegerU(st->stats.define_reallocs);
+}
+
+static ScmObj stats_get_round_trips(ScmObj obj)
+{
+    Scm_OCIStats *st = (Scm_OCIStats*)obj;
+    return Scm_MakeIntegerU(st->stats.round_trips);
+}
+
+static ScmClassStaticSlotSpec stats_slots[] = {
+    SCM_CLASS_SLOT_SPEC("prepare-time", stats_get_prepare_time, NULL),
+    SCM_CLASS_SLOT_SPEC("execute-time", stats_get_execute_time, NULL),
+    SCM_CLASS_SLOT_SPEC("fetch-time", stats_get_fetch_time, NULL),
+    SCM_CLASS_SLOT_SPEC("executes", stats_get_executes, NULL),
+    SCM_CLASS_SLOT_SPEC("fetches", stats_get_fetches, NULL),
+    SCM_CLASS_SLOT_SPEC("rows", stats_get_rows, NULL),
+    SCM_CLASS_SLOT_SPEC("bytes", stats_get_bytes, NULL),
+    SCM_CLASS_SLOT_SPEC("bind-reallocs", stats_get_bind_reallocs, NULL),
+    SCM_CLASS_SLOT_SPEC("define-reallocs", stats_get_define_reallocs, NULL),
+    SCM_CLASS_SLOT_SPEC("round-trips", stats_get_round_trips, NULL),
+    SCM_CLASS_SLOT_SPEC_END()
+};
+
 void Scm_Init_dbd_oracle(void)
 {
     ScmModule *mod;
@@ -528,7 +3156,11 @@ void Scm_Init_dbd_oracle(void)
     Scm_InitStaticClass(&Scm_OCIErrorClass, "<oracle-error>", mod, NULL, 0);
     Scm_InitStaticClass(&Scm_OCISvcCtxClass, "<oracle-svcctx>", mod, NULL, 0);
     Scm_InitStaticClass(&Scm_OCIStmtClass, "<oracle-stmt>", mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_OCISPoolClass, "<oracle-spool>", mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_OCIDirPathClass, "<oracle-dirpath>", mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_OCILobClass, "<oracle-lob>", mod, NULL, 0);
     Scm_InitStaticClass(&Scm_OCIParamMetadataClass, "<oracle-param-metadata>", mod, param_metadata_slots, 0);
+    Scm_InitStaticClass(&Scm_OCIStatsClass, "<oracle-stats>", mod, stats_slots, 0);
 
     /* Register stub-generated procedures */
     Scm_Init_dbd_oraclelib(mod);
@@ -16,6 +16,15 @@ enum dbd_oracle_bind_type {
     BIND_STRING,
     BIND_INTEGER,
     BIND_REAL,
+    BIND_BFLOAT,
+    BIND_BDOUBLE,
+    BIND_DATE,
+    BIND_TIMESTAMP,
+    BIND_TIMESTAMP_TZ,
+    BIND_TIMESTAMP_LTZ,
+    BIND_CLOB,
+    BIND_BLOB,
+    BIND_LONG,
 };
 
 /* oracle-error */
@@ -34,6 +43,14 @@ SCM_CLASS_DECL(Scm_OCISvcCtxClass);
 
 typedef struct Scm_OCISvcCtx Scm_OCISvcCtx;
 
+/* oracle-spool */
+SCM_CLASS_DECL(Scm_OCISPoolClass);
+#define SCM_CLASS_OCISPOOL   (&Scm_OCISPoolClass)
+#define SCM_ORACLE_SPOOL(obj)    ((Scm_OCISPool*)obj)
+#define SCM_ORACLE_SPOOL_P(obj)   SCM_XTYPEP(obj, SCM_CLASS_OCISPOOL)
+
+typedef struct Scm_OCISPool Scm_OCISPool;
+
 /* oracle-stmt */
 SCM_CLASS_DECL(Scm_OCIStmtClass);
 #define SCM_CLASS_OCISTMT   (&Scm_OCIStmtClass)
@@ -42,6 +59,22 @@ SCM_CLASS_DECL(Scm_OCIStmtClass);
 
 typedef struct Scm_OCIStmt Scm_OCIStmt;
 
+/* oracle-dirpath */
+SCM_CLASS_DECL(Scm_OCIDirPathClass);
+#define SCM_CLASS_OCIDIRPATH   (&Scm_OCIDirPathClass)
+#define SCM_ORACLE_DIRPATH(obj)    ((Scm_OCIDirPath*)obj)
+#define SCM_ORACLE_DIRPATH_P(obj)   SCM_XTYPEP(obj, SCM_CLASS_OCIDIRPATH)
+
+typedef struct Scm_OCIDirPath Scm_OCIDirPath;
+
+/* oracle-lob */
+SCM_CLASS_DECL(Scm_OCILobClass);
+#define SCM_CLASS_OCILOB   (&Scm_OCILobClass)
+#define SCM_ORACLE_LOB(obj)    ((Scm_OCILob*)obj)
+#define SCM_ORACLE_LOB_P(obj)   SCM_XTYPEP(obj, SCM_CLASS_OCILOB)
+
+typedef struct Scm_OCILob Scm_OCILob;
+
 /* oracle-param-metadata */
 SCM_CLASS_DECL(Scm_OCIParamMetadataClass);
 #define SCM_CLASS_OCIPARAMMETADATA   (&Scm_OCIParamMetadataClass)
@@ -50,55 +83,176 @@ SCM_CLASS_DECL(Scm_OCIParamMetadataClass);
 
 typedef struct Scm_OCIParamMetadata Scm_OCIParamMetadata;
 
+/* oracle-stats */
+SCM_CLASS_DECL(Scm_OCIStatsClass);
+#define SCM_CLASS_OCISTATS   (&Scm_OCIStatsClass)
+#define SCM_ORACLE_STATS(obj)    ((Scm_OCIStats*)obj)
+#define SCM_ORACLE_STATS_P(obj)   SCM_XTYPEP(obj, SCM_CLASS_OCISTATS)
+
+typedef struct Scm_OCIStats Scm_OCIStats;
+
 /* Module initialization function. */
 extern void Scm_Init_dbd_oraclelib(ScmModule*);
 
 
 extern ScmObj Scm_make_oracle_error(void);
 extern void Scm_oracle_error_close(Scm_OCIError *err);
-extern ScmObj Scm_error_to_message(int status, Scm_OCIError *err);
+extern void Scm_oracle_raise_error(sword status, void *errhp, ub4 htype);
 
 extern ScmObj Scm_oracle_connect(Scm_OCIError *err, const char *user, const char *passwd, const char *dbname);
 extern ScmObj Scm_oracle_disconnect(Scm_OCIError *err, Scm_OCISvcCtx *svcctx);
-extern ScmObj Scm_oracle_stmt_prepare(Scm_OCIError *err, const char *sql);
+extern ScmObj Scm_oracle_set_autocommit(Scm_OCIError *err, Scm_OCISvcCtx *svcctx, int autocommit);
+extern ScmObj Scm_oracle_autocommit_p(Scm_OCIError *err, Scm_OCISvcCtx *svcctx);
+extern ScmObj Scm_oracle_set_nonblocking(Scm_OCIError *err, Scm_OCISvcCtx *svcctx, int nonblocking);
+extern ScmObj Scm_oracle_nonblocking_p(Scm_OCIError *err, Scm_OCISvcCtx *svcctx);
+extern ScmObj Scm_oracle_commit(Scm_OCIError *err, Scm_OCISvcCtx *svcctx);
+extern ScmObj Scm_oracle_rollback(Scm_OCIError *err, Scm_OCISvcCtx *svcctx);
+extern ScmObj Scm_oracle_pool_create(Scm_OCIError *err, const char *user, const char *passwd, const char *dbname,
+                                     u_int min, u_int max, u_int incr, u_int timeout);
+extern ScmObj Scm_oracle_pool_close(Scm_OCIError *err, Scm_OCISPool *pool);
+extern ScmObj Scm_oracle_pool_connect(Scm_OCIError *err, Scm_OCISPool *pool);
+extern ScmObj Scm_oracle_pool_count_get(Scm_OCIError *err, Scm_OCISPool *pool, Scm_OCISvcCtx *svcctx);
+extern ScmObj Scm_oracle_pool_stats(Scm_OCIError *err, Scm_OCISPool *pool);
+extern ScmObj Scm_oracle_svcctx_stats(Scm_OCIError *err, Scm_OCISvcCtx *svcctx);
+extern ScmObj Scm_oracle_svcctx_reset_stats(Scm_OCIError *err, Scm_OCISvcCtx *svcctx);
+extern ScmObj Scm_oracle_set_stmt_cache_size(Scm_OCIError *err, Scm_OCISvcCtx *svcctx, u_int size);
+extern ScmObj Scm_oracle_stmt_prepare(Scm_OCIError *err, Scm_OCISvcCtx *svcctx, const char *sql, int bind_count);
 extern void Scm_oracle_stmt_close(Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_set_fetch_size(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int size);
+extern ScmObj Scm_oracle_stmt_set_scrollable(Scm_OCIError *err, Scm_OCIStmt *stmt, int scrollable);
+extern ScmObj Scm_oracle_stmt_set_prefetch_rows(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int rows);
+extern ScmObj Scm_oracle_stmt_set_prefetch_memory(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int size);
+extern ScmObj Scm_oracle_stmt_round_trips(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_stats(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_last_stats(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_reset_stats(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_reset_last_stats(Scm_OCIError *err, Scm_OCIStmt *stmt);
 extern ScmObj Scm_oracle_stmt_bind_count(Scm_OCIError *err, Scm_OCIStmt *stmt);
-extern ScmObj Scm_oracle_stmt_bind_init(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size);
-extern ScmObj Scm_oracle_stmt_bind_set(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, ScmObj val);
-extern ScmObj Scm_oracle_stmt_bind_ref(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos);
+extern ScmObj Scm_oracle_stmt_bind_init(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size, u_int rows);
+extern ScmObj Scm_oracle_stmt_bind_names(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_set_bind_names(Scm_OCIError *err, Scm_OCIStmt *stmt, ScmObj names);
+extern ScmObj Scm_oracle_stmt_bind_params(Scm_OCIError *err, Scm_OCIStmt *stmt, ScmObj params);
+extern ScmObj Scm_oracle_stmt_bind_param(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, ScmObj val);
+extern ScmObj Scm_oracle_stmt_bind_out(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size, ScmObj val);
+extern ScmObj Scm_oracle_stmt_bind_table(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size, u_int max, ScmObj vals);
+extern ScmObj Scm_oracle_stmt_bind_lob(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, ScmObj port);
+extern ScmObj Scm_oracle_stmt_bind_rows(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos);
+extern ScmObj Scm_oracle_stmt_bind_set(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, u_int row, ScmObj val);
+extern ScmObj Scm_oracle_stmt_bind_ref(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, u_int row);
 extern ScmObj Scm_oracle_stmt_column_init(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos, int type, u_int size);
 extern ScmObj Scm_oracle_stmt_column_ref(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int pos);
 extern ScmObj Scm_oracle_stmt_execute(Scm_OCIError *err, Scm_OCISvcCtx *svcctx, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_execute_start(Scm_OCIError *err, Scm_OCISvcCtx *svcctx, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_execute_poll(Scm_OCIError *err, Scm_OCISvcCtx *svcctx, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_execute_batch(Scm_OCIError *err, Scm_OCISvcCtx *svcctx, Scm_OCIStmt *stmt, u_int iters);
 extern ScmObj Scm_oracle_stmt_fetch(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_fetch_start(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_fetch_poll(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_fetch_row(Scm_OCIError *err, Scm_OCIStmt *stmt, ScmObj row);
+extern ScmObj Scm_oracle_stmt_scroll(Scm_OCIError *err, Scm_OCIStmt *stmt, int orientation, int offset, ScmObj row);
+extern ScmObj Scm_oracle_stmt_position(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_fetch_rows(Scm_OCIError *err, Scm_OCIStmt *stmt, u_int max);
+extern ScmObj Scm_oracle_stmt_fetch_rows_x(Scm_OCIError *err, Scm_OCIStmt *stmt, ScmObj rows);
+extern ScmObj Scm_oracle_stmt_fetch_columns(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_cancel(Scm_OCIError *err, Scm_OCIStmt *stmt);
 extern ScmObj Scm_oracle_stmt_type(Scm_OCIError *err, Scm_OCIStmt *stmt);
 extern ScmObj Scm_oracle_stmt_row_count(Scm_OCIError *err, Scm_OCIStmt *stmt);
 extern ScmObj Scm_oracle_stmt_params(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_define_columns(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_stmt_columns_defined_p(Scm_OCIError *err, Scm_OCIStmt *stmt);
+extern ScmObj Scm_oracle_dirpath_prepare(Scm_OCIError *err, Scm_OCISvcCtx *svcctx, ScmObj schema, const char *table,
+                                         ScmObj columns, u_int rows, u_int buf_size);
+extern ScmObj Scm_oracle_dirpath_load_rows(Scm_OCIError *err, Scm_OCIDirPath *dp, ScmObj rows);
+extern ScmObj Scm_oracle_dirpath_load_columns(Scm_OCIError *err, Scm_OCIDirPath *dp, ScmObj columns, ScmObj nulls);
+extern ScmObj Scm_oracle_dirpath_finish(Scm_OCIError *err, Scm_OCIDirPath *dp);
+extern ScmObj Scm_oracle_dirpath_abort(Scm_OCIError *err, Scm_OCIDirPath *dp);
+extern ScmObj Scm_oracle_dirpath_row_count(Scm_OCIError *err, Scm_OCIDirPath *dp);
+extern ScmObj Scm_oracle_lob_length(Scm_OCILob *lob);
+extern ScmObj Scm_oracle_lob_chunk_size(Scm_OCILob *lob);
+extern ScmObj Scm_oracle_lob_buffer_size(Scm_OCILob *lob);
+extern ScmObj Scm_oracle_lob_read(Scm_OCILob *lob, ScmUInt64 offset, ScmObj buf);
+
+/* placeholders */
+extern ScmObj Scm_oracle_parse_sql(const char *sql);
 
 /* bind values */
+extern OCIEnv *envhp;
+
 typedef struct bind_handle_vptr bind_handle_vptr_t;
 typedef struct bind_handle bind_handle_t;
 
+/* default number of rows fetched by one OCIStmtFetch call */
+#define DEFAULT_FETCH_SIZE 100
+
+/*
+ * define size of LONG and LONG RAW columns, whose data_size is zero.
+ * They are fetched piecewise in pieces of this size.
+ */
+#define LONG_DEFINE_SIZE (64 * 1024)
+
+/* chunk size of a LOB whose chunk size is unknown */
+#define LOB_DEFAULT_CHUNK_SIZE 8192
+
+/* columns larger than this are not placed in the column arena */
+#define ARENA_MAX_VALUE_SIZE (32 * 1024)
+
+/* alignment of each buffer in the column arena */
+#define ARENA_ALIGN 16
+
+/* how a bind handle is bound */
+enum bind_handle_mode {
+    BIND_MODE_VALUE,     /* a value, or an array of values for batch execution */
+    BIND_MODE_RETURNING, /* RETURNING INTO, bound by OCIBindDynamic */
+    BIND_MODE_TABLE      /* PL/SQL index-by table */
+};
+
 struct bind_handle {
     const bind_handle_vptr_t *vptr;
+    int type; /* enum dbd_oracle_bind_type */
+    u_int size; /* size passed to bind_handle_prepare */
     void *bindp; /* OCIBInd* or OCIDefine* */
-    void *valuep;
-    sb4 value_sz;
-    sb2 ind;
-    union {
-        long l;
-        double d;
-    } value;
+    void *valuep; /* array of max_rows values */
+    sb4 value_sz; /* size of each value */
+    ub4 max_rows;
+    sb2 *ind; /* array of max_rows indicators */
+    ub2 *rlen; /* array of max_rows return lengths */
+    OCIError *errhp; /* used to convert values */
+    int own_buffers; /* TRUE when valuep, ind and rlen are freed by bind_handle_clear */
+    int mode; /* enum bind_handle_mode */
+    ub4 rows_returned; /* number of rows returned into a RETURNING INTO bind */
+    ub4 rows_unallocated; /* rows returned into a RETURNING INTO bind whose buffers couldn't be allocated */
+    ub4 curelen; /* number of elements of a PL/SQL index-by table */
+    ub4 *alen; /* lengths of the returned values, passed to OCI by the callback */
+    Scm_OCIStmt *stmt; /* the statement of the handle, which LOB values belong to */
 };
 
 struct bind_handle_vptr {
     sb2 dty;
     void (*init)(bind_handle_t *hndl, u_int size);
+    int (*setup)(bind_handle_t *hndl); /* called after valuep is allocated. returns FALSE on failure. may be NULL. */
     void (*clear)(bind_handle_t *hndl);
-    void (*set)(bind_handle_t *hndl, ScmObj val);
-    ScmObj (*get)(bind_handle_t *hndl);
+    void (*set)(bind_handle_t *hndl, ub4 idx, ScmObj val);
+    ScmObj (*get)(bind_handle_t *hndl, ub4 idx);
 };
 
-extern void bind_handle_init(bind_handle_t *hndl, int dty, u_int size);
+#define BIND_HANDLE_VALUE(hndl, idx) ((char*)(hndl)->valuep + (size_t)(hndl)->value_sz * (idx))
+
+extern void bind_handle_init(bind_handle_t *hndl, OCIError *errhp, int dty, u_int size, ub4 rows);
+extern void bind_handle_prepare(bind_handle_t *hndl, OCIError *errhp, int dty, u_int size, ub4 rows);
+extern void bind_handle_alloc(bind_handle_t *hndl);
+extern int bind_handle_try_alloc(bind_handle_t *hndl);
+extern int bind_handle_reusable(bind_handle_t *hndl, int type, u_int *size, ub4 *rows);
+extern int bind_handle_date_type(ScmObj val);
+extern void bind_handle_attach(bind_handle_t *hndl, void *valuep, sb2 *ind, ub2 *rlen);
+extern void bind_handle_clear(bind_handle_t *hndl);
+extern void bind_handle_long_reset(bind_handle_t *hndl);
+extern sb4 bind_handle_long_cb(dvoid *octxp, OCIDefine *defnp, ub4 iter, dvoid **bufpp,
+                               ub4 **alenp, ub1 *piecep, dvoid **indp, ub2 **rcodep);
+
+/* LOB values of bind handles */
+extern ScmObj Scm_oracle_make_lob(Scm_OCIStmt *stmt, OCILobLocator *src, int type);
+extern void Scm_oracle_lob_assign(Scm_OCIStmt *stmt, ScmObj val, OCILobLocator **dst);
+extern void Scm_oracle_lob_free_temporary(Scm_OCIStmt *stmt, OCILobLocator *locp);
 
 /* Epilogue */
 SCM_DECL_END
@@ -0,0 +1,132 @@
+#include <ctype.h>
+#include "dbd_oracle.h"
+
+/*
+ * Placeholder lexer
+ *
+ * Rewrites each ? in a SQL statement to :1, :2, ... and collects the
+ * names of the placeholders in one pass. Comments, string literals,
+ * quoted identifiers and q'...' literals are copied as they are.
+ */
+
+static int is_ident_char(int c)
+{
+    return isalnum(c) || c == '_' || c == '$' || c == '#';
+}
+
+/* the closing delimiter of q'[...]', q'{...}', q'<...>', q'(...)' and q'X...X' */
+static char q_quote_close(char open)
+{
+    switch (open) {
+    case '[': return ']';
+    case '{': return '}';
+    case '<': return '>';
+    case '(': return ')';
+    default: return open;
+    }
+}
+
+/* adds the name in upper case unless it is in names already. */
+static ScmObj add_name(ScmObj names, const char *name, size_t len)
+{
+    char buf[128];
+    size_t i;
+    ScmObj str;
+
+    if (len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    for (i = 0; i < len; i++) {
+        buf[i] = toupper((unsigned char)name[i]);
+    }
+    str = Scm_MakeString(buf, len, len, SCM_STRING_COPYING);
+    if (!SCM_FALSEP(Scm_Member(str, names, SCM_CMP_EQUAL))) {
+        return names;
+    }
+    return Scm_Cons(str, names);
+}
+
+/*
+ * Returns (rewritten-sql . names), where names is the list of the
+ * placeholder names in the order of their first appearance. The name
+ * of the nth ? is the number n.
+ */
+ScmObj Scm_oracle_parse_sql(const char *sql)
+{
+    size_t len = strlen(sql);
+    size_t qmarks = 0;
+    const char *p = sql;
+    const char *end = sql + len;
+    char *buf, *out;
+    ScmObj names = SCM_NIL;
+    ScmObj result;
+    int n = 0;
+
+    for (p = sql; p < end; p++) {
+        if (*p == '?') {
+            qmarks++;
+        }
+    }
+    /* each ? becomes a colon and at most 10 digits. */
+    buf = out = malloc(len + qmarks * 10 + 1);
+    if (buf == NULL) {
+        Scm_Error("failed to allocate %lu bytes", (u_long)(len + qmarks * 10 + 1));
+    }
+
+    p = sql;
+    while (p < end) {
+        const char *start = p;
+
+        if (p[0] == '-' && p[1] == '-') {
+            /* comment to the end of line */
+            while (p < end && *p != '\n') {
+                p++;
+            }
+        } else if (p[0] == '/' && p[1] == '*') {
+            const char *close = strstr(p + 2, "*/");
+            p = close ? close + 2 : end;
+        } else if ((p == sql || !is_ident_char((unsigned char)p[-1]))
+                   && ((tolower((unsigned char)p[0]) == 'q' && p[1] == '\'' && p[2] != '\0')
+                       || (tolower((unsigned char)p[0]) == 'n' && tolower((unsigned char)p[1]) == 'q'
+                           && p[2] == '\'' && p[3] != '\0'))) {
+            /* alternative quoting: q'[...]' or nq'[...]' */
+            char close;
+
+            p += tolower((unsigned char)p[0]) == 'n' ? 3 : 2;
+            close = q_quote_close(*p++);
+            while (p < end && !(p[0] == close && p[1] == '\'')) {
+                p++;
+            }
+            p = p < end ? p + 2 : end;
+        } else if (p[0] == '\'' || p[0] == '"') {
+            /* a doubled quote is read as two adjacent literals. */
+            const char *close = strchr(p + 1, p[0]);
+            p = close ? close + 1 : end;
+        } else if (p[0] == '?') {
+            char num[16];
+            int numlen = snprintf(num, sizeof(num), "%d", ++n);
+
+            *out++ = ':';
+            memcpy(out, num, numlen);
+            out += numlen;
+            /* the numbers are unique, so they are not looked up in names. */
+            names = Scm_Cons(Scm_MakeString(num, numlen, numlen, SCM_STRING_COPYING), names);
+            p++;
+            continue;
+        } else if (p[0] == ':' && is_ident_char((unsigned char)p[1])) {
+            p++;
+            while (p < end && is_ident_char((unsigned char)*p)) {
+                p++;
+            }
+            names = add_name(names, start + 1, p - start - 1);
+        } else {
+            p++;
+        }
+        memcpy(out, start, p - start);
+        out += p - start;
+    }
+    result = Scm_Cons(Scm_MakeString(buf, out - buf, -1, SCM_STRING_COPYING),
+                      Scm_ReverseX(names));
+    free(buf);
+    return result;
+}
@@ -6,6 +6,10 @@
 (use gauche.test)
 (use gauche.collection)
 (use util.relation)
+(use gauche.generator)
+(use gauche.uvector)
+(use gauche.threads)
+(use srfi-19)
 
 (test-start "dbd.oracle")
 (use dbd.oracle)
@@ -50,6 +54,50 @@
                       (getter row "position")))
 		  result)))
 
+(test* "dbi-prepare select with :fetch-size" '((1 "Buffon") (10 "Del Piero"))
+       (let* ([q (dbi-prepare conn "SELECT id, name FROM test ORDER BY id"
+                              :fetch-size 1)]
+              [r (dbi-execute q)]
+              [getter (relation-accessor r)])
+	 (map (lambda (row)
+                (list (getter row "id")
+                      (getter row "name")))
+              r)))
+
+(test* "dbi-prepare select with :prefetch-rows" 4
+       (let1 q (dbi-prepare conn "SELECT id, name FROM test ORDER BY id"
+                            :fetch-size 1 :prefetch-rows 10)
+         (size-of (dbi-execute q))
+         ;; one execute, two fetches for two rows and one for the end of data.
+         (oracle-query-round-trips q)))
+
+(test* "x->generator" '(#(1 "Buffon") #(10 "Del Piero"))
+       (generator->list
+        (x->generator (dbi-do conn "SELECT id, name FROM test ORDER BY id"))))
+
+(test* "dbi-close (result)" '(#t #f)
+       (let* ([r (dbi-do conn "SELECT id FROM test ORDER BY id" '(:fetch-size 1))]
+              [open? (dbi-open? r)])
+         (dbi-close r)
+         (list open? (dbi-open? r))))
+
+(test* "statement cache" '(1 1)
+       (let ([before (oracle-statement-cache-stats conn)]
+             [sql "SELECT name FROM test WHERE id = ?"])
+         (dbi-close (dbi-prepare conn sql))
+         (dbi-close (dbi-prepare conn sql))
+         (let1 after (oracle-statement-cache-stats conn)
+           (map (lambda (key)
+                  (- (cdr (assq key after)) (cdr (assq key before))))
+                '(hits misses)))))
+
+(test* "oracle-result->columns" '(#s64(1 10) #("Buffon" "Del Piero") #f64(0.5 5.0) #f64(0.25 2.5) #u8(0 0))
+       (let1 r (dbi-do conn "SELECT id, name, TO_BINARY_DOUBLE(id / 2), TO_BINARY_FLOAT(id / 4) \
+                             FROM test ORDER BY id" '(:fetch-size 1))
+         (receive (columns nulls) (oracle-result->columns r)
+           (list (vector-ref columns 0) (vector-ref columns 1) (vector-ref columns 2)
+                 (vector-ref columns 3) (vector-ref nulls 0)))))
+
 (test* "dbi-prepare insert & execute" '<oracle-query>
        (let1 q (dbi-prepare conn "INSERT INTO test VALUES (?, ?, ?)")
 	 (set! query q)
@@ -63,6 +111,28 @@
        (begin (dbi-close query)
 	      (dbi-open? query)))
 
+(test* "dbi-execute-batch" '(2 ((1 1)))
+       (let1 q (dbi-prepare conn "INSERT INTO test VALUES (?, ?, ?)")
+         (receive (count errors)
+             (dbi-execute-batch q '((20 "Cannavaro" "DF") (20 "Materazzi" "DF")
+                                    #(21 "Pirlo" ())))
+           (list count
+                 (map (lambda (e) (list (car e) (cadr e))) errors)))))
+
+(test* "dbi-execute-batch with inexact integers" '(1 ())
+       (let1 q (dbi-prepare conn "UPDATE test SET name = name WHERE id = ?")
+         (receive (count errors) (dbi-execute-batch q '((1.0) (2.5)))
+           (list count errors))))
+
+(test* "dbi-execute-batch result" '((20 "Cannavaro" "DF") (21 "Pirlo" ()))
+       (let* ([r (dbi-do conn "SELECT * FROM test WHERE id >= 20 ORDER BY id")]
+              [getter (relation-accessor r)])
+	 (map (lambda (row)
+                (list (getter row "id")
+                      (getter row "name")
+                      (getter row "position")))
+              r)))
+
 (test* "dbi-prepare select & execute" '((11 "Nedved" "MF"))
        (let* ([q (dbi-prepare conn "SELECT * FROM test WHERE id=?")]
               [r (dbi-execute q 11)]
@@ -88,6 +158,307 @@
               [e (guard (e [else e]) (dbi-execute q))])
          (class-name (class-of e))))
 
+(test* "dbd-oracle-error" '(<dbd-oracle-error> 942)
+       (let1 e (guard (e [else e]) (dbi-do conn "SELECT * FROM no_such_table"))
+         (list (class-name (class-of e)) (condition-ref e 'error-code))))
+
+(test* "call-with-transaction (rollback)" '()
+       (begin
+         (guard (e [else #f])
+           (call-with-transaction conn
+             (lambda (c)
+               (dbi-do c "INSERT INTO test VALUES (30, 'Totti', 'FW')")
+               (error "abort"))))
+         (map identity (dbi-do conn "SELECT id FROM test WHERE id = 30"))))
+
+(test* "call-with-transaction (commit)" '(#(30))
+       (begin
+         (call-with-transaction conn
+           (lambda (c)
+             (dbi-do c "INSERT INTO test VALUES (30, 'Totti', 'FW')")))
+         (map identity (dbi-do conn "SELECT id FROM test WHERE id = 30"))))
+
+(test* "session pool" '((1 "Buffon") (1 . 0))
+       (let* ([pool (make-oracle-pool "dbi:oracle://localhost/XE"
+                                      :username "ruby" :password "oci8"
+                                      :min 1 :max 2)]
+              [c (dbi-connect "dbi:oracle://localhost/XE" :pool pool)]
+              [r (dbi-do c "SELECT id, name FROM test WHERE id = 1")]
+              [row (map (cut vector->list <>) r)])
+         (dbi-close c)
+         (let1 stats (oracle-pool-stats pool)
+           (dbi-close pool)
+           (list (car row)
+                 (cons (cdr (assq 'gets stats)) (cdr (assq 'busy stats)))))))
+
+(test* "sessions got from a pool by threads" '((1) (1) (1) (1) 4)
+       (let* ([pool (make-oracle-pool "dbi:oracle://localhost/XE"
+                                      :username "ruby" :password "oci8"
+                                      :min 1 :max 4)]
+              [worker (lambda ()
+                        (let1 c (dbi-connect "dbi:oracle://localhost/XE" :pool pool)
+                          (unwind-protect
+                              (vector->list (car (map identity (dbi-do c "SELECT 1 FROM dual"))))
+                            (dbi-close c))))]
+              [results (map thread-join!
+                            (map (lambda (_) (thread-start! (make-thread worker)))
+                                 '(1 2 3 4)))]
+              [stats (oracle-pool-stats pool)])
+         (dbi-close pool)
+         (append results (list (cdr (assq 'gets stats))))))
+
+(test* "relation-column-getter" '((1 "Buffon") (10 "Del Piero"))
+       (let* ([r (dbi-do conn "SELECT id, name FROM test ORDER BY id")]
+              [id (relation-column-getter r "id")]
+              [name (relation-column-getter r 'name)])
+         (map (lambda (row) (list (id row) (name row))) r)))
+
+(test* "placeholders in quotes" '(("?" "it's ?" 1))
+       (map vector->list
+            (dbi-do conn "SELECT '?', q'[it's ?]', ? FROM dual -- ?" '() 1)))
+
+(test* "oracle-execute-named" '((10 "Del Piero"))
+       (let1 q (dbi-prepare conn "SELECT id, name FROM test WHERE id = :id OR name = :name OR id = :ID")
+         (map vector->list (oracle-execute-named q :name "Del Piero" :id 10))))
+
+(test* "CREATE TRIGGER with :new isn't bound" '(("BONUCCI"))
+       (begin
+         (dbi-do conn "CREATE OR REPLACE TRIGGER test_upper BEFORE INSERT ON test \
+                       FOR EACH ROW BEGIN :new.name := UPPER(:new.name); END;")
+         (dbi-do conn "INSERT INTO test VALUES (40, 'Bonucci', 'DF')")
+         (dbi-do conn "DROP TRIGGER test_upper")
+         (begin0 (map vector->list (dbi-do conn "SELECT name FROM test WHERE id = 40"))
+                 (dbi-do conn "DELETE FROM test WHERE id = 40"))))
+
+;; rows are made in C
+(test* "oracle-result-fetch-row reuses a row" '(#t #(1 "Buffon") #(10 "Del Piero") #f)
+       (let* ([r (dbi-do conn "SELECT id, name FROM test ORDER BY id")]
+              [row (make-vector 2)]
+              [r1 (vector-copy (oracle-result-fetch-row r row))]
+              [r2 (oracle-result-fetch-row r row)])
+         (list (eq? r2 row) r1 (vector-copy r2) (oracle-result-fetch-row r row))))
+
+(test* "oracle-result-fetch-rows" '((#(1) #(10)) ())
+       (let1 r (dbi-do conn "SELECT id FROM test ORDER BY id")
+         (list (oracle-result-fetch-rows r 5) (oracle-result-fetch-rows r))))
+
+(test* "oracle-result-fetch-rows!" '(2 #(#(1) #(10) #f))
+       (let ([r (dbi-do conn "SELECT id FROM test ORDER BY id")]
+             [rows (make-vector 3 #f)])
+         (list (oracle-result-fetch-rows! r rows) rows)))
+
+;; counters of queries and connections
+(test* "oracle-query-stats" '(2 2 1 0)
+       (let1 q (dbi-prepare conn "SELECT id FROM test WHERE id <= 10" :fetch-size 10)
+         (dbi-execute q)
+         (size-of (dbi-execute q))
+         (let1 stats (oracle-query-stats q)
+           (oracle-reset-stats! q)
+           (list (slot-ref stats 'executes)
+                 (slot-ref stats 'rows)
+                 (slot-ref stats 'define-reallocs)
+                 (slot-ref (oracle-query-stats q) 'executes)))))
+
+(test* "slow statement hook" '("SELECT id FROM test WHERE id = ?" 1)
+       (let1 hooked #f
+         (oracle-set-slow-statement-hook! conn 0
+                                          (lambda (sql stats)
+                                            (set! hooked (list sql (slot-ref stats 'rows)))))
+         (size-of (dbi-do conn "SELECT id FROM test WHERE id = ?" '() 1))
+         (oracle-set-slow-statement-hook! conn 0 #f)
+         hooked))
+
+(test* "oracle-result-scroll" '(#(10) 2 #(1) 1 #f #(10) #(1))
+       (let1 r (dbi-do conn "SELECT id FROM test WHERE id <= 10 ORDER BY id" '(:scrollable #t))
+         (list (oracle-result-scroll r 'last)
+               (oracle-result-position r)
+               (oracle-result-scroll r 'first)
+               (oracle-result-position r)
+               (oracle-result-scroll r 'absolute 3)
+               (oracle-result-scroll r 'relative 1)
+               (oracle-result-scroll r 'prior))))
+
+(test* "scrollable result as a sequence" '(2 #(10) #(1) ((1) (10)) ((1) (10)))
+       (let1 r (dbi-do conn "SELECT id FROM test WHERE id <= 10 ORDER BY id" '(:scrollable #t))
+         (list (size-of r) (ref r 1) (ref r 0)
+               (map vector->list r) (map vector->list r))))
+
+(test* "OUT and IN OUT binds" '(3 "ab")
+       (let ([x (oracle-out 'integer)]
+             [s (oracle-in-out "a" :size 10)])
+         (dbi-do conn "BEGIN :x := 1 + 2; :s := :s || 'b'; END;" '() x s)
+         (list (oracle-out-value x) (oracle-out-value s))))
+
+(test* "RETURNING INTO" '(2 (1 10) ("Buffon" "Del Piero"))
+       (let ([id (oracle-out 'integer)]
+             [name (oracle-out 'string :size 40)])
+         (let1 count (dbi-do conn "UPDATE test SET name = name WHERE id IN (1, 10) RETURNING id, name INTO ?, ?"
+                             '() id name)
+           (list count (sort (oracle-out-values id)) (sort (oracle-out-values name))))))
+
+(test* "RETURNING INTO no rows" '(0 ())
+       (let1 id (oracle-out 'integer)
+         (let1 count (dbi-do conn "UPDATE test SET name = name WHERE id = -1 RETURNING id INTO ?"
+                             '() id)
+           (list count (oracle-out-values id)))))
+
+(test* "PL/SQL table IN" '(6 6.5)
+       (let ([sum (oracle-out 'real)]
+             [plsql "DECLARE t DBMS_SQL.NUMBER_TABLE := :t; BEGIN :s := 0; FOR i IN 1 .. t.COUNT LOOP :s := :s + t(i); END LOOP; END;"])
+         (dbi-do conn plsql '() '(1 2 3) sum)
+         (let1 s1 (oracle-out-value sum)
+           (dbi-do conn plsql '() (f64vector 1.5 2 3) sum)
+           (list s1 (oracle-out-value sum)))))
+
+(test* "PL/SQL table OUT and IN OUT" '(#("a" "b" "c") #(2 4 6))
+       (let ([strs (oracle-out 'string :size 10 :max-length 10)]
+             [nums (oracle-in-out (s64vector 1 2 3))])
+         (dbi-do conn "DECLARE s DBMS_SQL.VARCHAR2_TABLE; n DBMS_SQL.NUMBER_TABLE := :n; BEGIN s(1) := 'a'; s(2) := 'b'; s(3) := 'c'; :s := s; FOR i IN 1 .. n.COUNT LOOP n(i) := n(i) * 2; END LOOP; :n := n; END;"
+                 '() nums strs)
+         (list (oracle-out-value strs) (oracle-out-value nums))))
+
+(test* "direct path load" '(5 ((1 0.5 "a" "2009-02-14") (5 2.5 () ())))
+       (begin
+         (dbi-do conn "CREATE TABLE test_load (id integer, val number, name varchar2(30), d date)")
+         (let1 loader (make-oracle-loader conn "TEST_LOAD"
+                                          '((ID integer) (VAL real) (NAME string 30) (D date))
+                                          :rows 2)
+           (oracle-loader-load! loader `((1 0.5 "a" ,(make-date 0 0 0 0 14 2 2009 0))
+                                         #(2 1.0 "b" ())))
+           (oracle-loader-load-columns! loader
+                                        (list (s64vector 3 4 5) (f64vector 1.5 2.0 2.5)
+                                              '#("c" "d" "e") '(() () ()))
+                                        (list #f #f (u8vector 0 0 1) #f))
+           (let1 count (oracle-loader-finish! loader)
+             (begin0
+              (list count
+                    (map vector->list
+                         (dbi-do conn "SELECT id, val, name, TO_CHAR(d, 'YYYY-MM-DD') FROM test_load WHERE id IN (1, 5) ORDER BY id")))
+              (dbi-do conn "DROP TABLE test_load"))))))
+
+(test* "CLOB and BLOB" '(100000 100000 #t 3 "abc" #u8(1 2 3))
+       (begin
+         (dbi-do conn "CREATE TABLE test_lob (id integer, c clob, b blob)")
+         (let1 doc (make-string 100000 #\a)
+           (dbi-do conn "INSERT INTO test_lob VALUES (1, ?, ?)" '()
+                   (oracle-clob (open-input-string doc)) (oracle-blob (u8vector 1 2 3)))
+           (dbi-do conn "INSERT INTO test_lob VALUES (2, ?, NULL)" '() (oracle-clob "abc"))
+           (let1 rows (map vector->list (dbi-do conn "SELECT c, b FROM test_lob ORDER BY id"))
+             (begin0
+              (let ([c1 (car (car rows))]
+                    [b1 (cadr (car rows))]
+                    [c2 (car (cadr rows))])
+                (list (oracle-lob-length c1)
+                      (string-length (port->string (open-oracle-lob-input-port c1)))
+                      (equal? doc (port->string (open-oracle-lob-input-port c1)))
+                      (oracle-lob-length b1)
+                      (port->string (open-oracle-lob-input-port c2))
+                      (read-uvector <u8vector> 10 (open-oracle-lob-input-port b1))))
+              (dbi-do conn "DROP TABLE test_lob"))))))
+
+(test* "LONG longer than 64KB" 100000
+       (begin
+         (dbi-do conn "CREATE TABLE test_long (id integer, l long)")
+         (dbi-do conn "INSERT INTO test_long VALUES (1, ?)" '() (make-string 100000 #\a))
+         (begin0
+          (string-length (vector-ref (car (coerce-to <list> (dbi-do conn "SELECT l FROM test_long"))) 0))
+          (dbi-do conn "DROP TABLE test_long"))))
+
+(test* "threads sharing a connection" '(0 100 200 300 400 500 600 700)
+       (map thread-join!
+            (map (lambda (i)
+                   (thread-start!
+                    (make-thread
+                     (lambda ()
+                       (let1 q (dbi-prepare conn "SELECT CAST(? * 100 AS integer) FROM dual")
+                         (dotimes (n 20)
+                           (for-each (lambda (row) row) (dbi-execute q n)))
+                         (vector-ref (car (coerce-to <list> (dbi-execute q i))) 0))))))
+                 (iota 8))))
+
+(test* "transaction holds a shared connection" '(1 0)
+       (let1 count (lambda ()
+                     (x->integer (vector-ref (car (coerce-to <list> (dbi-do conn "SELECT count(*) FROM test_thread"))) 0)))
+         (dbi-do conn "CREATE TABLE test_thread (id integer)")
+         (let* ([t #f]
+                [in-transaction
+                 (call-with-transaction conn
+                   (lambda (c)
+                     (dbi-do c "INSERT INTO test_thread VALUES (1)")
+                     ;; the DELETE waits until the transaction is committed.
+                     (set! t (thread-start!
+                              (make-thread (cut dbi-do conn "DELETE FROM test_thread"))))
+                     (thread-sleep! 0.1)
+                     (count)))])
+           (thread-join! t)
+           (begin0
+            (list in-transaction (count))
+            (dbi-do conn "DROP TABLE test_thread")))))
+
+(test* "nonblocking execution on several connections" '((1) (2) (3))
+       (let1 conns (map (lambda (i)
+                          (dbi-connect "dbi:oracle://localhost/XE" :username "ruby" :password "oci8"))
+                        (iota 3))
+         (begin0
+          (map (lambda (r) (map (lambda (row) (x->integer (vector-ref row 0))) r))
+               (oracle-async-wait
+                (map (lambda (c i)
+                       (oracle-execute-start (dbi-prepare c "SELECT CAST(? AS integer) FROM dual") i))
+                     conns '(1 2 3))))
+          (for-each dbi-close conns))))
+
+(test* "nonblocking DML returns the row count" 1
+       (let1 a (oracle-execute-start (dbi-prepare conn "UPDATE test SET name = name WHERE id = ?") 1)
+         (oracle-async-result a)))
+
+(test* "nonblocking execution raises its error when waited for" (test-error <dbd-oracle-error>)
+       (oracle-async-result (oracle-execute-start (dbi-prepare conn "SELECT * FROM no_such_table_x"))))
+
+;; columns are described and defined once per prepared query
+(test* "re-execute select" '(((1 "Buffon")) ((10 "Del Piero")) ((1 "Buffon")))
+       (let1 q (dbi-prepare conn "SELECT id, name FROM test WHERE id = ?")
+         (map (lambda (id) (map vector->list (dbi-execute q id)))
+              '(1 10 1))))
+
+;; binds are reused while values of the same type are bound
+(test* "re-execute with growing binds" '(("a") ("bbbbbbbbbb") (()) ("cccccccccccccccccccccccccccccc"))
+       (let1 q (dbi-prepare conn "SELECT ? FROM dual")
+         (map (lambda (v) (map vector->list (dbi-execute q v)))
+              (list "a" (make-string 10 #\b) '() (make-string 30 #\c)))))
+
+;; string columns are defined by the sizes in the metadata
+(test* "column sizes" '(1 4000 "0A")
+       (let1 row (car (map identity
+                           (dbi-do conn "SELECT CAST('x' AS CHAR(1)), RPAD('x', 4000, 'x'), HEXTORAW('0A') \
+                                         FROM dual")))
+         (list (string-length (vector-ref row 0))
+               (string-length (vector-ref row 1))
+               (vector-ref row 2))))
+
+;; native date, timestamp and binary float types
+(test* "date and timestamp columns" '((2009 2 14 12 34 56 0) (2009 2 14 12 34 56 789000000) 3600)
+       (let1 row (car (map identity
+                           (dbi-do conn "SELECT TO_DATE('2009-02-14 12:34:56', 'YYYY-MM-DD HH24:MI:SS'), \
+                                                TO_TIMESTAMP('2009-02-14 12:34:56.789', 'YYYY-MM-DD HH24:MI:SS.FF'), \
+                                                TO_TIMESTAMP_TZ('2009-02-14 12:34:56 +01:00', 'YYYY-MM-DD HH24:MI:SS TZH:TZM') \
+                                         FROM dual")))
+         (define (fields d)
+           (list (date-year d) (date-month d) (date-day d)
+                 (date-hour d) (date-minute d) (date-second d) (date-nanosecond d)))
+         (list (fields (vector-ref row 0))
+               (fields (vector-ref row 1))
+               (date-zone-offset (vector-ref row 2)))))
+
+(test* "bind date" '(2009 2 14)
+       (let1 d (vector-ref (car (map identity
+                                     (dbi-do conn "SELECT ? + 1 FROM dual" '()
+                                             (make-date 0 0 0 0 13 2 2009 (date-zone-offset (current-date))))))
+                           0)
+         (list (date-year d) (date-month d) (date-day d))))
+
+(test* "binary_double column" 0.5
+       (vector-ref (car (map identity (dbi-do conn "SELECT TO_BINARY_DOUBLE(0.5) FROM dual"))) 0))
+
 (test* "dbi-do drop table test" #t
        (begin (dbi-do conn "DROP TABLE test") #t))
 